@@ -17,6 +17,7 @@ struct block {
   void* aux;                          /* Extra data owned by driver. */
 
   unsigned long long read_cnt;  /* Number of sectors read. */
+  unsigned long long read_req_cnt; /* 读请求数 */
   unsigned long long write_cnt; /* Number of sectors written. */
 };
 
@@ -98,6 +99,27 @@ void block_read(struct block* block, block_sector_t sector, void* buffer) {
   check_sector(block, sector);
   block->ops->read(block->aux, sector, buffer);
   block->read_cnt++;
+  block->read_req_cnt++;
+}
+
+/* 从BLOCK读CNT个以SECTOR开头的连续扇区到BUFFER，BUFFER至少
+   要有CNT * BLOCK_SECTOR_SIZE字节。驱动支持的话只发一个请求，
+   否则逐个扇区读 */
+void block_read_multiple(struct block* block, block_sector_t sector, size_t cnt, void* buffer) {
+  uint8_t* p = buffer;
+
+  if (cnt == 0)
+    return;
+  check_sector(block, sector);
+  check_sector(block, sector + cnt - 1);
+  if (block->ops->read_multiple != NULL) {
+    block->ops->read_multiple(block->aux, sector, cnt, buffer);
+    block->read_cnt += cnt;
+    block->read_req_cnt++;
+    return;
+  }
+  for (; cnt > 0; cnt--, sector++, p += BLOCK_SECTOR_SIZE)
+    block_read(block, sector, p);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -128,8 +150,8 @@ void block_print_stats(void) {
   for (i = 0; i < BLOCK_ROLE_CNT; i++) {
     struct block* block = block_by_role[i];
     if (block != NULL) {
-      printf("%s (%s): %llu reads, %llu writes\n", block->name, block_type_name(block->type),
-             block->read_cnt, block->write_cnt);
+      printf("%s (%s): %llu reads in %llu requests, %llu writes\n", block->name,
+             block_type_name(block->type), block->read_cnt, block->read_req_cnt, block->write_cnt);
     }
   }
 }
@@ -152,6 +174,7 @@ struct block* block_register(const char* name, enum block_type type, const char*
   block->ops = ops;
   block->aux = aux;
   block->read_cnt = 0;
+  block->read_req_cnt = 0;
   block->write_cnt = 0;
 
   printf("%s: %'" PRDSNu " sectors (", block->name, block->size);
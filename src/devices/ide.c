@@ -50,6 +50,9 @@
 #define CMD_READ_SECTOR_RETRY 0x20  /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR with retries. */
 
+/* 一条读命令最多读的扇区数（扇区数寄存器写0表示256） */
+#define IDE_MAX_SECTORS 256
+
 /* An ATA device. */
 struct ata_disk {
   char name[8];            /* Name, e.g. "hda". */
@@ -83,7 +86,7 @@ static void reset_channel(struct channel*);
 static bool check_device_type(struct ata_disk*);
 static void identify_ata_device(struct ata_disk*);
 
-static void select_sector(struct ata_disk*, block_sector_t);
+static void select_sector(struct ata_disk*, block_sector_t, size_t cnt);
 static void issue_pio_command(struct channel*, uint8_t command);
 static void input_sector(struct channel*, void*);
 static void output_sector(struct channel*, const void*);
@@ -314,7 +317,7 @@ static void ide_read(void* d_, block_sector_t sec_no, void* buffer) {
   struct ata_disk* d = d_;
   struct channel* c = d->channel;
   lock_acquire(&c->lock);
-  select_sector(d, sec_no);
+  select_sector(d, sec_no, 1);
   issue_pio_command(c, CMD_READ_SECTOR_RETRY);
   sema_down(&c->completion_wait);
   if (!wait_while_busy(d))
@@ -332,7 +335,7 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
   struct ata_disk* d = d_;
   struct channel* c = d->channel;
   lock_acquire(&c->lock);
-  select_sector(d, sec_no);
+  select_sector(d, sec_no, 1);
   issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy(d))
     PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
@@ -341,18 +344,47 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
   lock_release(&c->lock);
 }
 
-static struct block_operations ide_operations = {ide_read, ide_write};
+/* 从磁盘D读CNT个从SEC_NO开始的连续扇区到BUFFER。
+   一条READ SECTOR(S)命令最多读IDE_MAX_SECTORS个扇区，磁盘每准备好
+   一个扇区就来一次中断，中间不用再发命令。整个过程都持有通道锁，
+   BUFFER不能缺页：用户缓冲区要先钉住 */
+static void ide_read_multiple(void* d_, block_sector_t sec_no, size_t cnt, void* buffer) {
+  struct ata_disk* d = d_;
+  struct channel* c = d->channel;
+  uint8_t* p = buffer;
+
+  lock_acquire(&c->lock);
+  while (cnt > 0) {
+    size_t n = cnt < IDE_MAX_SECTORS ? cnt : IDE_MAX_SECTORS;
+    size_t i;
+
+    select_sector(d, sec_no, n);
+    issue_pio_command(c, CMD_READ_SECTOR_RETRY);
+    for (i = 0; i < n; i++, p += BLOCK_SECTOR_SIZE) {
+      sema_down(&c->completion_wait);
+      if (!wait_while_busy(d))
+        PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no + i);
+      input_sector(c, p);
+    }
+    sec_no += n;
+    cnt -= n;
+  }
+  lock_release(&c->lock);
+}
+
+static struct block_operations ide_operations = {ide_read, ide_write, ide_read_multiple};
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void select_sector(struct ata_disk* d, block_sector_t sec_no) {
+   writes SEC_NO and the sector count CNT to the disk's sector
+   selection registers.  (We use LBA mode.) */
+static void select_sector(struct ata_disk* d, block_sector_t sec_no, size_t cnt) {
   struct channel* c = d->channel;
 
   ASSERT(sec_no < (1UL << 28));
+  ASSERT(cnt > 0 && cnt <= IDE_MAX_SECTORS);
 
   select_device_wait(d);
-  outb(reg_nsect(c), 1);
+  outb(reg_nsect(c), cnt == IDE_MAX_SECTORS ? 0 : cnt);
   outb(reg_lbal(c), sec_no);
   outb(reg_lbam(c), sec_no >> 8);
   outb(reg_lbah(c), (sec_no >> 16));
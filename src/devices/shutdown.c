@@ -4,15 +4,30 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/init.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/parallel.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
+#include "userprog/ring.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -116,6 +131,11 @@ void shutdown_power_off(void) {
 static void print_stats(void) {
   timer_print_stats();
   thread_print_stats();
+  parallel_print_stats();
+  palloc_print_stats();
+  paging_print_stats();
+  malloc_stats();
+  slab_print_stats();
 #ifdef FILESYS
   block_print_stats();
 #endif
@@ -123,5 +143,15 @@ static void print_stats(void) {
   kbd_print_stats();
 #ifdef USERPROG
   exception_print_stats();
+  process_print_stats();
+  uaccess_print_stats();
+  syscall_print_stats();
+  ring_print_stats();
+  pipe_print_stats();
+#endif
+#ifdef VM
+  page_print_stats();
+  frame_print_stats();
+  swap_print_stats();
 #endif
 }
@@ -6,7 +6,7 @@ Copies one file to another. */
 #include <syscall.h>
 
 int main(int argc, char* argv[]) {
-  int in_fd, out_fd;
+  int in_fd, out_fd, size;
 
   if (argc != 3) {
     printf("usage: cp OLD NEW\n");
@@ -21,7 +21,8 @@ int main(int argc, char* argv[]) {
   }
 
   /* Create and open output file. */
-  if (!create(argv[2], filesize(in_fd))) {
+  size = filesize(in_fd);
+  if (!create(argv[2], size)) {
     printf("%s: create failed\n", argv[2]);
     return EXIT_FAILURE;
   }
@@ -31,16 +32,11 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
-  /* Copy data. */
-  for (;;) {
-    char buffer[1024];
-    int bytes_read = read(in_fd, buffer, sizeof buffer);
-    if (bytes_read == 0)
-      break;
-    if (write(out_fd, buffer, bytes_read) != bytes_read) {
-      printf("%s: write failed\n", argv[2]);
-      return EXIT_FAILURE;
-    }
+  /* Copy data inside the kernel, without a trip through a
+     user buffer. */
+  if (copy_file_range(in_fd, 0, out_fd, 0, size) != size) {
+    printf("%s: write failed\n", argv[2]);
+    return EXIT_FAILURE;
   }
 
   return EXIT_SUCCESS;
@@ -1,7 +1,7 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file {
@@ -10,11 +10,17 @@ struct file {
   bool deny_write;     /* Has file_deny_write() been called? */
 };
 
+/* struct file的对象缓存 */
+static struct kmem_cache* file_cache;
+
+/* Initializes the file module. */
+void file_init(void) { file_cache = kmem_cache_create("file", sizeof(struct file), NULL, NULL); }
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file* file_open(struct inode* inode) {
-  struct file* file = calloc(1, sizeof *file);
+  struct file* file = kmem_cache_alloc(file_cache);
   if (inode != NULL && file != NULL) {
     file->inode = inode;
     file->pos = 0;
@@ -22,7 +28,7 @@ struct file* file_open(struct inode* inode) {
     return file;
   } else {
     inode_close(inode);
-    free(file);
+    kmem_cache_free(file_cache, file);
     return NULL;
   }
 }
@@ -38,7 +44,7 @@ void file_close(struct file* file) {
   if (file != NULL) {
     file_allow_write(file);
     inode_close(file->inode);
-    free(file);
+    kmem_cache_free(file_cache, file);
   }
 }
 
@@ -91,6 +97,17 @@ off_t file_write_at(struct file* file, const void* buffer, off_t size, off_t fil
   return inode_write_at(file->inode, buffer, size, file_ofs);
 }
 
+/* Copies SIZE bytes from SRC, starting at offset SRC_START, to
+   DST, starting at offset DST_START, without passing the data
+   through a caller's buffer.  Returns the number of bytes
+   actually copied, which may be less than SIZE if end of either
+   file is reached.  Neither file's current position is
+   affected. */
+off_t file_copy_range(struct file* dst, off_t dst_start, struct file* src, off_t src_start,
+                      off_t size) {
+  return inode_copy_range(dst->inode, dst_start, src->inode, src_start, size);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void file_deny_write(struct file* file) {
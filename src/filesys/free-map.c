@@ -13,6 +13,8 @@ void free_map_init(void) {
   free_map = bitmap_create(block_size(fs_device));
   if (free_map == NULL)
     PANIC("bitmap creation failed--file system device is too large");
+  /* 文件都是连续分配的，用摘要层加速找长的空闲区 */
+  bitmap_enable_summary(free_map);
   bitmap_mark(free_map, FREE_MAP_SECTOR);
   bitmap_mark(free_map, ROOT_DIR_SECTOR);
 }
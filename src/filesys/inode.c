@@ -6,6 +6,9 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "userprog/uaccess.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -49,8 +52,14 @@ static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* struct inode的对象缓存 */
+static struct kmem_cache* inode_cache;
+
 /* Initializes the inode module. */
-void inode_init(void) { list_init(&open_inodes); }
+void inode_init(void) {
+  list_init(&open_inodes);
+  inode_cache = kmem_cache_create("inode", sizeof(struct inode), NULL, NULL);
+}
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
@@ -105,7 +114,7 @@ struct inode* inode_open(block_sector_t sector) {
   }
 
   /* Allocate memory. */
-  inode = malloc(sizeof *inode);
+  inode = kmem_cache_alloc(inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -148,7 +157,7 @@ void inode_close(struct inode* inode) {
       free_map_release(inode->data.start, bytes_to_sectors(inode->data.length));
     }
 
-    free(inode);
+    kmem_cache_free(inode_cache, inode);
   }
 }
 
@@ -159,6 +168,14 @@ void inode_remove(struct inode* inode) {
   inode->removed = true;
 }
 
+/* 整扇区能否直接在调用者的缓冲区BUFFER（SIZE字节）和磁盘
+   之间传。驱动在持有通道锁时读写BUFFER，这时缺页会死锁
+   （见vm/page.c），所以内核缓冲区可以，用户缓冲区必须已经
+   用pin_user()钉住；否则整扇区也经过bounce */
+static bool direct_ok(const void* buffer, off_t size) {
+  return !is_user_vaddr(buffer) || user_pinned(buffer, size);
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
@@ -166,6 +183,7 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
   uint8_t* buffer = buffer_;
   off_t bytes_read = 0;
   uint8_t* bounce = NULL;
+  bool direct = direct_ok(buffer, size);
 
   while (size > 0) {
     /* Disk sector to read, starting byte offset within sector. */
@@ -182,9 +200,14 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
     if (chunk_size <= 0)
       break;
 
-    if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
-      /* Read full sector directly into caller's buffer. */
-      block_read(fs_device, sector_idx, buffer + bytes_read);
+    if (direct && sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
+      /* 文件在磁盘上是连续的，后面所有的整扇区一次读进
+         调用者的缓冲区 */
+      off_t left = size < inode_left ? size : inode_left;
+      size_t cnt = left / BLOCK_SECTOR_SIZE;
+
+      block_read_multiple(fs_device, sector_idx, cnt, buffer + bytes_read);
+      chunk_size = cnt * BLOCK_SECTOR_SIZE;
     } else {
       /* Read sector into bounce buffer, then partially copy
              into caller's buffer. */
@@ -216,9 +239,11 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
   const uint8_t* buffer = buffer_;
   off_t bytes_written = 0;
   uint8_t* bounce = NULL;
+  bool direct;
 
   if (inode->deny_write_cnt)
     return 0;
+  direct = direct_ok(buffer, size);
 
   while (size > 0) {
     /* Sector to write, starting byte offset within sector. */
@@ -235,7 +260,7 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
     if (chunk_size <= 0)
       break;
 
-    if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
+    if (direct && sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
       /* Write full sector directly to disk. */
       block_write(fs_device, sector_idx, buffer + bytes_written);
     } else {
@@ -267,6 +292,49 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
   return bytes_written;
 }
 
+/* inode_copy_range()每次经过内核缓冲区的扇区数 */
+#define COPY_SECTORS 16
+
+/* 把SRC从SRC_OFS开始的SIZE个字节拷到DST的DST_OFS处，数据不经过
+   用户空间。每次用inode_read_at()读最多COPY_SECTORS个扇区到一块
+   内核缓冲区，再用inode_write_at()写出去；块的边界对齐SRC的扇区，
+   所以整扇区一次读多个、直接写盘，只有不满一个扇区的头尾要经过
+   bounce。返回拷贝的字节数，到了任一个文件的末尾或者DST拒绝写入时
+   会少于SIZE。SRC和DST是同一个inode时区间不能重叠 */
+off_t inode_copy_range(struct inode* dst, off_t dst_ofs, struct inode* src, off_t src_ofs,
+                       off_t size) {
+  uint8_t* buffer;
+  off_t copied = 0;
+
+  if (dst->deny_write_cnt)
+    return 0;
+  buffer = malloc(COPY_SECTORS * BLOCK_SECTOR_SIZE);
+  if (buffer == NULL)
+    return 0;
+
+  while (size > 0) {
+    off_t chunk = COPY_SECTORS * BLOCK_SECTOR_SIZE - src_ofs % BLOCK_SECTOR_SIZE;
+    off_t bytes_read, bytes_written;
+
+    if (chunk > size)
+      chunk = size;
+    bytes_read = inode_read_at(src, buffer, chunk, src_ofs);
+    if (bytes_read == 0)
+      break;
+    bytes_written = inode_write_at(dst, buffer, bytes_read, dst_ofs);
+    copied += bytes_written;
+    if (bytes_written < bytes_read)
+      break;
+
+    size -= bytes_read;
+    src_ofs += bytes_read;
+    dst_ofs += bytes_read;
+  }
+  free(buffer);
+
+  return copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void inode_deny_write(struct inode* inode) {
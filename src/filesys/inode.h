@@ -16,6 +16,8 @@ void inode_close(struct inode*);
 void inode_remove(struct inode*);
 off_t inode_read_at(struct inode*, void*, off_t size, off_t offset);
 off_t inode_write_at(struct inode*, const void*, off_t size, off_t offset);
+off_t inode_copy_range(struct inode* dst, off_t dst_ofs, struct inode* src, off_t src_ofs,
+                       off_t size);
 void inode_deny_write(struct inode*);
 void inode_allow_write(struct inode*);
 off_t inode_length(const struct inode*);
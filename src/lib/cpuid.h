@@ -0,0 +1,44 @@
+#ifndef __LIB_CPUID_H
+#define __LIB_CPUID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Feature bits reported by CPUID leaf 1 in EDX. */
+#define CPUID_PSE (1u << 3)  /* 4 MB pages. */
+#define CPUID_SEP (1u << 11) /* SYSENTER and SYSEXIT. */
+#define CPUID_PGE (1u << 13) /* Global pages. */
+
+/* Executes CPUID for LEAF and returns the feature bits it
+   reports in EDX, storing the signature it reports in EAX into
+   *SIGNATURE if SIGNATURE is nonnull.  CPUID is available in
+   both kernel and user mode.
+   See [IA32-v2a] "CPUID". */
+static inline uint32_t cpuid_features(uint32_t* signature) {
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+
+  asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+  if (signature != NULL)
+    *signature = eax;
+  return edx;
+}
+
+/* Returns true if the CPU implements SYSENTER and SYSEXIT.
+   Early Pentium Pro parts report CPUID_SEP without supporting
+   the instructions.
+   See [IA32-v3a] 5.8.7 "Performing Fast Calls to System
+   Procedures with the SYSENTER and SYSEXIT Instructions". */
+static inline bool cpu_has_sysenter(void) {
+  uint32_t signature;
+  uint32_t features = cpuid_features(&signature);
+  unsigned family = (signature >> 8) & 0xf;
+  unsigned model = (signature >> 4) & 0xf;
+  unsigned stepping = signature & 0xf;
+
+  if (!(features & CPUID_SEP))
+    return false;
+  return !(family == 6 && model < 3 && stepping < 3);
+}
+
+#endif /* lib/cpuid.h */
@@ -21,12 +21,26 @@ typedef unsigned long elem_type;
 /* Number of bits in an element. */
 #define ELEM_BITS (sizeof(elem_type) * CHAR_BIT)
 
+/* 摘要层：每CHUNK_BITS位一块，记录块内0位的游程，
+   找长的连续0时可以整块跳过放不下的区域 */
+#define CHUNK_ELEMS 32
+#define CHUNK_BITS (CHUNK_ELEMS * ELEM_BITS)
+
+/* 一块的摘要。dirty为真时其他成员已过期，用到时再重新计算 */
+struct chunk_summary {
+  uint16_t head;    /* 块开头连续0的个数 */
+  uint16_t tail;    /* 块末尾连续0的个数 */
+  uint16_t longest; /* 块内最长的连续0 */
+  bool dirty;       /* 修改过 */
+};
+
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
    simulates an array of bits. */
 struct bitmap {
-  size_t bit_cnt;  /* Number of bits. */
-  elem_type* bits; /* Elements that represent bits. */
+  size_t bit_cnt;                 /* Number of bits. */
+  elem_type* bits;                /* Elements that represent bits. */
+  struct chunk_summary* summary;  /* 摘要层，没有启用时为空 */
 };
 
 /* Returns the index of the element that contains the bit
@@ -50,6 +64,44 @@ static inline elem_type last_mask(const struct bitmap* b) {
   return last_bits ? ((elem_type)1 << last_bits) - 1 : (elem_type)-1;
 }
 
+/* 返回一个元素中从第START位（含）到第END位（不含）为1、
+   其余为0的掩码。0 <= START < END <= ELEM_BITS */
+static inline elem_type range_mask(size_t start, size_t end) {
+  elem_type hi = end < ELEM_BITS ? ((elem_type)1 << end) - 1 : (elem_type)-1;
+  return hi & ~(((elem_type)1 << start) - 1);
+}
+
+/* 返回元素E中1的个数。内核没有链接libgcc，
+   不能用__builtin_popcount() */
+static inline size_t popcount(elem_type e) {
+  e = e - ((e >> 1) & 0x55555555);
+  e = (e & 0x33333333) + ((e >> 2) & 0x33333333);
+  e = (e + (e >> 4)) & 0x0f0f0f0f;
+  return (e * 0x01010101) >> 24;
+}
+
+/* 返回B的摘要块数 */
+static inline size_t chunk_cnt(const struct bitmap* b) { return DIV_ROUND_UP(b->bit_cnt, CHUNK_BITS); }
+
+/* 标记包含第BIT_IDX位的摘要块已过期 */
+static inline void mark_dirty(struct bitmap* b, size_t bit_idx) {
+  if (b->summary != NULL)
+    b->summary[bit_idx / CHUNK_BITS].dirty = true;
+}
+
+/* 标记[START, START + CNT)涉及的摘要块都已过期 */
+static void mark_dirty_range(struct bitmap* b, size_t start, size_t cnt) {
+  size_t i;
+
+  if (b->summary == NULL || cnt == 0)
+    return;
+  for (i = start / CHUNK_BITS; i <= (start + cnt - 1) / CHUNK_BITS; i++)
+    b->summary[i].dirty = true;
+}
+
+static size_t find_next(const struct bitmap*, size_t start, size_t end, bool value);
+static void update_chunk(const struct bitmap*, size_t chunk);
+
 /* Creation and destruction. */
 
 /* Creates and returns a pointer to a newly allocated bitmap with room for
@@ -60,6 +112,7 @@ struct bitmap* bitmap_create(size_t bit_cnt) {
   struct bitmap* b = malloc(sizeof *b);
   if (b != NULL) {
     b->bit_cnt = bit_cnt;
+    b->summary = NULL;
     b->bits = malloc(byte_cnt(bit_cnt));
     if (b->bits != NULL || bit_cnt == 0) {
       bitmap_set_all(b, false);
@@ -80,6 +133,7 @@ struct bitmap* bitmap_create_in_buf(size_t bit_cnt, void* block, size_t block_si
 
   b->bit_cnt = bit_cnt;
   b->bits = (elem_type*)(b + 1);
+  b->summary = NULL;
   bitmap_set_all(b, false);
   return b;
 }
@@ -92,11 +146,31 @@ size_t bitmap_buf_size(size_t bit_cnt) { return sizeof(struct bitmap) + byte_cnt
    Not for use on bitmaps created by bitmap_create_in_buf(). */
 void bitmap_destroy(struct bitmap* b) {
   if (b != NULL) {
+    free(b->summary);
     free(b->bits);
     free(b);
   }
 }
 
+/* 为B启用摘要层，之后找连续0时会跳过放不下的块。
+   内存不够时返回false，B仍然可用，只是没有摘要。
+   对bitmap_create_in_buf()创建的位图，摘要层是malloc()出来的，
+   不会被释放 */
+bool bitmap_enable_summary(struct bitmap* b) {
+  size_t i;
+
+  ASSERT(b != NULL);
+  if (b->summary != NULL || b->bit_cnt == 0)
+    return true;
+
+  b->summary = malloc(chunk_cnt(b) * sizeof *b->summary);
+  if (b->summary == NULL)
+    return false;
+  for (i = 0; i < chunk_cnt(b); i++)
+    b->summary[i].dirty = true;
+  return true;
+}
+
 /* Bitmap size. */
 
 /* Returns the number of bits in B. */
@@ -123,6 +197,7 @@ void bitmap_mark(struct bitmap* b, size_t bit_idx) {
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the OR instruction in [IA32-v2b]. */
   asm("orl %1, %0" : "=m"(b->bits[idx]) : "r"(mask) : "cc");
+  mark_dirty(b, bit_idx);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -134,6 +209,7 @@ void bitmap_reset(struct bitmap* b, size_t bit_idx) {
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
   asm("andl %1, %0" : "=m"(b->bits[idx]) : "r"(~mask) : "cc");
+  mark_dirty(b, bit_idx);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -147,6 +223,7 @@ void bitmap_flip(struct bitmap* b, size_t bit_idx) {
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
   asm("xorl %1, %0" : "=m"(b->bits[idx]) : "r"(mask) : "cc");
+  mark_dirty(b, bit_idx);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -165,47 +242,61 @@ void bitmap_set_all(struct bitmap* b, bool value) {
   bitmap_set_multiple(b, 0, bitmap_size(b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, but not the range as a
+   whole. */
 void bitmap_set_multiple(struct bitmap* b, size_t start, size_t cnt, bool value) {
+  size_t end = start + cnt;
   size_t i;
 
   ASSERT(b != NULL);
   ASSERT(start <= b->bit_cnt);
   ASSERT(start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set(b, start + i, value);
+  /* 按元素整块设置 */
+  for (i = start; i < end;) {
+    size_t idx = elem_idx(i);
+    size_t stop = (idx + 1) * ELEM_BITS < end ? (idx + 1) * ELEM_BITS : end;
+    elem_type mask = range_mask(i % ELEM_BITS, stop - idx * ELEM_BITS);
+
+    if (value)
+      asm("orl %1, %0" : "=m"(b->bits[idx]) : "r"(mask) : "cc");
+    else
+      asm("andl %1, %0" : "=m"(b->bits[idx]) : "r"(~mask) : "cc");
+    i = stop;
+  }
+  mark_dirty_range(b, start, cnt);
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t bitmap_count(const struct bitmap* b, size_t start, size_t cnt, bool value) {
-  size_t i, value_cnt;
+  size_t end = start + cnt;
+  size_t i, ones;
 
   ASSERT(b != NULL);
   ASSERT(start <= b->bit_cnt);
   ASSERT(start + cnt <= b->bit_cnt);
 
-  value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test(b, start + i) == value)
-      value_cnt++;
-  return value_cnt;
+  ones = 0;
+  for (i = start; i < end;) {
+    size_t idx = elem_idx(i);
+    size_t stop = (idx + 1) * ELEM_BITS < end ? (idx + 1) * ELEM_BITS : end;
+
+    ones += popcount(b->bits[idx] & range_mask(i % ELEM_BITS, stop - idx * ELEM_BITS));
+    i = stop;
+  }
+  return value ? ones : cnt - ones;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool bitmap_contains(const struct bitmap* b, size_t start, size_t cnt, bool value) {
-  size_t i;
-
   ASSERT(b != NULL);
   ASSERT(start <= b->bit_cnt);
   ASSERT(start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test(b, start + i) == value)
-      return true;
-  return false;
+  return find_next(b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -228,22 +319,120 @@ bool bitmap_all(const struct bitmap* b, size_t start, size_t cnt) {
 
 /* Finding set or unset bits. */
 
+/* 返回[START, END)中第一个值为VALUE的位的下标，没有则返回END。
+   全是!VALUE的元素整个跳过 */
+static size_t find_next(const struct bitmap* b, size_t start, size_t end, bool value) {
+  size_t idx, last;
+
+  if (start >= end)
+    return end;
+
+  idx = elem_idx(start);
+  last = elem_idx(end - 1);
+  for (; idx <= last; idx++) {
+    elem_type e = value ? b->bits[idx] : ~b->bits[idx];
+
+    if (idx == elem_idx(start))
+      e &= ~(((elem_type)1 << (start % ELEM_BITS)) - 1);
+    if (e != 0) {
+      size_t bit = idx * ELEM_BITS + __builtin_ctzl(e);
+      return bit < end ? bit : end;
+    }
+  }
+  return end;
+}
+
+/* 不用摘要，在[START, END)里找CNT个连续的VALUE */
+static size_t scan_runs(const struct bitmap* b, size_t start, size_t end, size_t cnt, bool value) {
+  size_t i = start;
+
+  while (i + cnt <= end) {
+    size_t run_start = find_next(b, i, end, value);
+    size_t run_end;
+
+    if (run_start + cnt > end)
+      break;
+    run_end = find_next(b, run_start, run_start + cnt, !value);
+    if (run_end == run_start + cnt)
+      return run_start;
+    i = run_end;
+  }
+  return BITMAP_ERROR;
+}
+
+/* 重新计算第CHUNK块的摘要 */
+static void update_chunk(const struct bitmap* b, size_t chunk) {
+  struct chunk_summary* s = &b->summary[chunk];
+  size_t start = chunk * CHUNK_BITS;
+  size_t end = start + CHUNK_BITS < b->bit_cnt ? start + CHUNK_BITS : b->bit_cnt;
+  size_t i = start;
+
+  s->head = find_next(b, start, end, true) - start;
+  s->longest = 0;
+  s->tail = 0;
+  while (i < end) {
+    size_t run_start = find_next(b, i, end, false);
+    size_t run_end = find_next(b, run_start, end, true);
+
+    if (run_end - run_start > s->longest)
+      s->longest = run_end - run_start;
+    if (run_end == end)
+      s->tail = run_end - run_start;
+    i = run_end;
+  }
+  s->dirty = false;
+}
+
+/* 用摘要找CNT个连续的0：只有当前块内最长的0，或者前面
+   跨块延续下来的0加上当前块开头的0够长时，才在这一块里
+   逐元素查找。能放下的游程一定在本块结束之前结束 */
+static size_t scan_summary(const struct bitmap* b, size_t start, size_t cnt) {
+  size_t carry = 0; /* 延续到当前块开头的0的个数 */
+  size_t chunk;
+
+  for (chunk = start / CHUNK_BITS; chunk < chunk_cnt(b); chunk++) {
+    struct chunk_summary* s = &b->summary[chunk];
+    size_t chunk_start = chunk * CHUNK_BITS;
+
+    if (s->dirty)
+      update_chunk(b, chunk);
+    if (carry + s->head >= cnt || s->longest >= cnt) {
+      size_t from = chunk_start - carry > start ? chunk_start - carry : start;
+      size_t end = chunk_start + CHUNK_BITS < b->bit_cnt ? chunk_start + CHUNK_BITS : b->bit_cnt;
+      size_t idx = scan_runs(b, from, end, cnt, false);
+
+      /* START落在块中间时可能是误报，继续往后找 */
+      if (idx != BITMAP_ERROR)
+        return idx;
+    }
+    if (s->head == CHUNK_BITS)
+      carry += CHUNK_BITS;
+    else
+      carry = s->tail;
+  }
+  return BITMAP_ERROR;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Whole elements of the wrong value are skipped at once.  When
+   looking for false bits in a bitmap with a summary (see
+   bitmap_enable_summary()), whole chunks that cannot hold CNT
+   bits are skipped as well. */
 size_t bitmap_scan(const struct bitmap* b, size_t start, size_t cnt, bool value) {
   ASSERT(b != NULL);
   ASSERT(start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) {
-    size_t last = b->bit_cnt - cnt;
-    size_t i;
-    for (i = start; i <= last; i++)
-      if (!bitmap_contains(b, i, cnt, !value))
-        return i;
-  }
-  return BITMAP_ERROR;
+  if (cnt > b->bit_cnt || start > b->bit_cnt - cnt)
+    return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+  if (!value && b->summary != NULL && cnt > ELEM_BITS)
+    return scan_summary(b, start, cnt);
+  return scan_runs(b, start, b->bit_cnt, cnt, value);
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -274,6 +463,7 @@ bool bitmap_read(struct bitmap* b, struct file* file) {
     off_t size = byte_cnt(b->bit_cnt);
     success = file_read_at(file, b->bits, size, 0) == size;
     b->bits[elem_cnt(b->bit_cnt) - 1] &= last_mask(b);
+    mark_dirty_range(b, 0, b->bit_cnt);
   }
   return success;
 }
@@ -0,0 +1,56 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+#include <stdint.h>
+
+/* Submission and completion rings for asynchronous file I/O.
+
+   A process places a struct ring in its own memory and registers
+   it with ring_setup().  To queue requests it fills entries of
+   SQ and advances SQ_TAIL, then hands everything queued so far
+   to the kernel with one ring_enter() call.  Kernel worker
+   threads carry out the requests concurrently and post a
+   completion to CQ for each one, advancing CQ_TAIL.  The process
+   reaps completions by reading CQ up to CQ_TAIL and advancing
+   CQ_HEAD, without entering the kernel.
+
+   Buffers must stay mapped until their request completes.  A read
+   or write whose OFFSET is above INT32_MAX, or whose OFFSET + SIZE
+   is, completes with result -1. */
+
+/* Number of entries in each ring.  A power of 2. */
+#define RING_ENTRIES 64
+
+/* Request operations. */
+#define RING_OP_READ 1  /* Read SIZE bytes at OFFSET into BUFFER. */
+#define RING_OP_WRITE 2 /* Write SIZE bytes from BUFFER at OFFSET. */
+#define RING_OP_FSYNC 3 /* Wait until earlier writes are on disk. */
+
+/* Submission queue entry. */
+struct ring_sqe {
+  uint32_t op;        /* One of RING_OP_*. */
+  int32_t fd;         /* File descriptor. */
+  void* buffer;       /* Data buffer for RING_OP_READ and RING_OP_WRITE. */
+  uint32_t size;      /* Number of bytes to transfer. */
+  uint32_t offset;    /* File offset. */
+  uint32_t user_data; /* Copied into the completion. */
+};
+
+/* Completion queue entry. */
+struct ring_cqe {
+  uint32_t user_data; /* From the submission. */
+  int32_t result;     /* Bytes transferred, 0 for RING_OP_FSYNC, or -1. */
+};
+
+/* A pair of rings shared between a process and the kernel.
+   Indexes run freely and are reduced modulo RING_ENTRIES. */
+struct ring {
+  uint32_t sq_head; /* Next submission the kernel takes (kernel writes). */
+  uint32_t sq_tail; /* One past the last submission (process writes). */
+  uint32_t cq_head; /* Next completion to reap (process writes). */
+  uint32_t cq_tail; /* One past the last completion (kernel writes). */
+  struct ring_sqe sq[RING_ENTRIES];
+  struct ring_cqe cq[RING_ENTRIES];
+};
+
+#endif /* lib/ring.h */
@@ -1,6 +1,9 @@
 #ifndef __LIB_SYSCALL_NR_H
 #define __LIB_SYSCALL_NR_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* System call numbers. */
 enum {
   /* Projects 2 and later. */
@@ -39,7 +42,47 @@ enum {
   SYS_MKDIR,   /* Create a directory. */
   SYS_READDIR, /* Reads a directory entry. */
   SYS_ISDIR,   /* Tests if a fd represents a directory. */
-  SYS_INUMBER  /* Returns the inode number for a fd. */
+  SYS_INUMBER, /* Returns the inode number for a fd. */
+
+  /* Extensions. */
+  SYS_FORK,            /* Duplicate the current process. */
+  SYS_SYSSTAT,         /* Report call statistics for a system call. */
+  SYS_BATCH,           /* Execute several system calls at once. */
+  SYS_RING_SETUP,      /* Register asynchronous I/O rings. */
+  SYS_RING_ENTER,      /* Submit to and wait on asynchronous I/O rings. */
+  SYS_DUP,             /* Duplicate a file descriptor. */
+  SYS_DUP2,            /* Duplicate a file descriptor onto another. */
+  SYS_PREAD,           /* Read from a file at a given offset. */
+  SYS_PWRITE,          /* Write to a file at a given offset. */
+  SYS_READV,           /* Read from a file into several buffers. */
+  SYS_WRITEV,          /* Write to a file from several buffers. */
+  SYS_COPY_FILE_RANGE, /* Copy data between files inside the kernel. */
+  SYS_PIPE             /* Create a pipe. */
+};
+
+/* Per-system-call statistics, as returned by SYS_SYSSTAT. */
+struct sysstat {
+  uint64_t calls;  /* Number of calls. */
+  uint64_t cycles; /* Total TSC cycles spent in the handler. */
+};
+
+/* One system call in a SYS_BATCH request. */
+struct syscall_entry {
+  uint32_t number;  /* System call number. */
+  uint32_t args[5]; /* Arguments; unused ones are ignored. */
+  int32_t result;   /* Return value, filled in by the kernel. */
 };
 
+/* SYS_BATCH flags. */
+#define BATCH_STOP_ON_ERROR 0x1 /* Stop after the first negative result. */
+
+/* One buffer in a SYS_READV or SYS_WRITEV request. */
+struct iovec {
+  void* iov_base; /* Start of the buffer. */
+  size_t iov_len; /* Length of the buffer in bytes. */
+};
+
+/* Maximum number of buffers in one SYS_READV or SYS_WRITEV. */
+#define IOV_MAX 64
+
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,16 @@
+#ifndef __LIB_TSC_H
+#define __LIB_TSC_H
+
+#include <stdint.h>
+
+/* Reads the CPU's time-stamp counter.  RDTSC is available in
+   both kernel and user mode, so benchmarks on either side of
+   the system call boundary can use it.
+   See [IA32-v2b] "RDTSC". */
+static inline uint64_t rdtsc(void) {
+  uint32_t lo, hi;
+  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+#endif /* lib/tsc.h */
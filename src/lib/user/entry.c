@@ -1,6 +1,11 @@
+#include <cpuid.h>
 #include <syscall.h>
 
 int main(int, char* []);
 void _start(int argc, char* argv[]);
 
-void _start(int argc, char* argv[]) { exit(main(argc, argv)); }
+void _start(int argc, char* argv[]) {
+  /* The kernel enables SYSENTER whenever the CPU has it. */
+  syscall_sysenter = cpu_has_sysenter();
+  exit(main(argc, argv));
+}
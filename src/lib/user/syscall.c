@@ -2,15 +2,29 @@
 #include "../syscall-nr.h"
 #include <pthread.h>
 
+/* True if system calls enter the kernel through SYSENTER rather
+   than int $0x30.  Set by _start(); tests may clear it to time
+   the slow path. */
+bool syscall_sysenter;
+
+/* Enters the kernel for a system call whose number and arguments
+   have already been pushed.  With SYSENTER, passes the stack
+   pointer in ECX and the return address in EDX, as the kernel's
+   sysenter_entry expects.  Clobbers ECX and EDX either way. */
+#define SYSCALL_ENTER                                                                              \
+  "cmpb $0, syscall_sysenter; je 1f; "                                                             \
+  "movl %%esp, %%ecx; movl $2f, %%edx; sysenter; "                                                 \
+  "1: int $0x30; 2: "
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                                                           \
   ({                                                                                               \
     int retval;                                                                                    \
-    asm volatile("pushl %[number]; int $0x30; addl $4, %%esp"                                      \
+    asm volatile("pushl %[number]; " SYSCALL_ENTER "addl $4, %%esp"                                \
                  : "=a"(retval)                                                                    \
                  : [number] "i"(NUMBER)                                                            \
-                 : "memory");                                                                      \
+                 : "ecx", "edx", "memory");                                                        \
     retval;                                                                                        \
   })
 
@@ -19,10 +33,10 @@
 #define syscall1(NUMBER, ARG0)                                                                     \
   ({                                                                                               \
     int retval;                                                                                    \
-    asm volatile("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp"                       \
+    asm volatile("pushl %[arg0]; pushl %[number]; " SYSCALL_ENTER "addl $8, %%esp"                 \
                  : "=a"(retval)                                                                    \
                  : [number] "i"(NUMBER), [arg0] "g"(ARG0)                                          \
-                 : "memory");                                                                      \
+                 : "ecx", "edx", "memory");                                                        \
     retval;                                                                                        \
   })
 
@@ -31,10 +45,10 @@
 #define syscall1f(NUMBER, ARG0)                                                                    \
   ({                                                                                               \
     float retval;                                                                                  \
-    asm volatile("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp"                       \
+    asm volatile("pushl %[arg0]; pushl %[number]; " SYSCALL_ENTER "addl $8, %%esp"                 \
                  : "=a"(retval)                                                                    \
                  : [number] "i"(NUMBER), [arg0] "g"(ARG0)                                          \
-                 : "memory");                                                                      \
+                 : "ecx", "edx", "memory");                                                        \
     retval;                                                                                        \
   })
 
@@ -44,10 +58,10 @@
   ({                                                                                               \
     int retval;                                                                                    \
     asm volatile("pushl %[arg1]; pushl %[arg0]; "                                                  \
-                 "pushl %[number]; int $0x30; addl $12, %%esp"                                     \
+                 "pushl %[number]; " SYSCALL_ENTER "addl $12, %%esp"                               \
                  : "=a"(retval)                                                                    \
                  : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1)                        \
-                 : "memory");                                                                      \
+                 : "ecx", "edx", "memory");                                                        \
     retval;                                                                                        \
   })
 
@@ -57,9 +71,42 @@
   ({                                                                                               \
     int retval;                                                                                    \
     asm volatile("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "                                   \
-                 "pushl %[number]; int $0x30; addl $16, %%esp"                                     \
+                 "pushl %[number]; " SYSCALL_ENTER "addl $16, %%esp"                               \
                  : "=a"(retval)                                                                    \
                  : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1), [arg2] "r"(ARG2)      \
+                 : "ecx", "edx", "memory");                                                        \
+    retval;                                                                                        \
+  })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'.  ARG3 is
+   pushed first, while it can still be addressed relative to the
+   frame, so it may live in memory; that leaves enough registers
+   for the rest. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                                                   \
+  ({                                                                                               \
+    int retval;                                                                                    \
+    asm volatile("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "                    \
+                 "pushl %[number]; " SYSCALL_ENTER "addl $20, %%esp"                               \
+                 : "=a"(retval)                                                                    \
+                 : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1), [arg2] "r"(ARG2),     \
+                   [arg3] "g"(ARG3)                                                                \
+                 : "ecx", "edx", "memory");                                                        \
+    retval;                                                                                        \
+  })
+
+/* Invokes syscall NUMBER, passing arguments ARG0 through ARG4,
+   and returns the return value as an `int'.  ARG3 and ARG4 are
+   passed in ECX and EDX, which the system call clobbers anyway,
+   because there are too few other registers. */
+#define syscall5(NUMBER, ARG0, ARG1, ARG2, ARG3, ARG4)                                             \
+  ({                                                                                               \
+    int retval;                                                                                    \
+    uint32_t arg3 = (uint32_t)(ARG3), arg4 = (uint32_t)(ARG4);                                     \
+    asm volatile("pushl %[arg4]; pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "     \
+                 "pushl %[number]; " SYSCALL_ENTER "addl $24, %%esp"                               \
+                 : "=a"(retval), [arg3] "+c"(arg3), [arg4] "+d"(arg4)                              \
+                 : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1), [arg2] "r"(ARG2)      \
                  : "memory");                                                                      \
     retval;                                                                                        \
   })
@@ -78,6 +125,26 @@ void exit(int status) {
 
 pid_t exec(const char* file) { return (pid_t)syscall1(SYS_EXEC, file); }
 
+pid_t fork(void) { return (pid_t)syscall0(SYS_FORK); }
+
+bool sysstat(int nr, struct sysstat* st) { return syscall2(SYS_SYSSTAT, nr, st); }
+
+int syscall_batch(struct syscall_entry* entries, int cnt, unsigned flags) {
+  return syscall3(SYS_BATCH, entries, cnt, flags);
+}
+
+bool ring_setup(struct ring* ring) { return syscall1(SYS_RING_SETUP, ring); }
+
+int ring_enter(unsigned to_submit, unsigned min_complete) {
+  return syscall2(SYS_RING_ENTER, to_submit, min_complete);
+}
+
+int dup(int fd) { return syscall1(SYS_DUP, fd); }
+
+int dup2(int old_fd, int new_fd) { return syscall2(SYS_DUP2, old_fd, new_fd); }
+
+int pipe(int fds[2]) { return syscall1(SYS_PIPE, fds); }
+
 int wait(pid_t pid) { return syscall1(SYS_WAIT, pid); }
 
 bool create(const char* file, unsigned initial_size) {
@@ -96,6 +163,27 @@ int write(int fd, const void* buffer, unsigned size) {
   return syscall3(SYS_WRITE, fd, buffer, size);
 }
 
+int pread(int fd, void* buffer, unsigned size, unsigned offset) {
+  return syscall4(SYS_PREAD, fd, buffer, size, offset);
+}
+
+int pwrite(int fd, const void* buffer, unsigned size, unsigned offset) {
+  return syscall4(SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int readv(int fd, const struct iovec* iov, int iovcnt) {
+  return syscall3(SYS_READV, fd, iov, iovcnt);
+}
+
+int writev(int fd, const struct iovec* iov, int iovcnt) {
+  return syscall3(SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int copy_file_range(int src_fd, unsigned src_offset, int dst_fd, unsigned dst_offset,
+                    unsigned length) {
+  return syscall5(SYS_COPY_FILE_RANGE, src_fd, src_offset, dst_fd, dst_offset, length);
+}
+
 void seek(int fd, unsigned position) { syscall2(SYS_SEEK, fd, position); }
 
 unsigned tell(int fd) { return syscall1(SYS_TELL, fd); }
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <pthread.h>
+#include <ring.h>
+#include <syscall-nr.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -24,10 +26,24 @@ typedef int mapid_t;
 #define EXIT_SUCCESS 0 /* Successful execution. */
 #define EXIT_FAILURE 1 /* Unsuccessful execution. */
 
+/* True if system calls use SYSENTER rather than int $0x30. */
+extern bool syscall_sysenter;
+
 /* Projects 2 and later. */
 void halt(void) NO_RETURN;
 void exit(int status) NO_RETURN;
 pid_t exec(const char* file);
+pid_t fork(void);
+bool sysstat(int nr, struct sysstat*);
+int syscall_batch(struct syscall_entry*, int cnt, unsigned flags);
+bool ring_setup(struct ring*);
+int ring_enter(unsigned to_submit, unsigned min_complete);
+/* The console descriptors STDIN_FILENO and STDOUT_FILENO cannot be
+   duplicated or replaced: dup() and dup2() return -1 if either
+   descriptor is one of them. */
+int dup(int fd);
+int dup2(int old_fd, int new_fd);
+int pipe(int fds[2]);
 int wait(pid_t);
 bool create(const char* file, unsigned initial_size);
 bool remove(const char* file);
@@ -35,6 +51,12 @@ int open(const char* file);
 int filesize(int fd);
 int read(int fd, void* buffer, unsigned length);
 int write(int fd, const void* buffer, unsigned length);
+int pread(int fd, void* buffer, unsigned length, unsigned offset);
+int pwrite(int fd, const void* buffer, unsigned length, unsigned offset);
+int readv(int fd, const struct iovec*, int iovcnt);
+int writev(int fd, const struct iovec*, int iovcnt);
+int copy_file_range(int src_fd, unsigned src_offset, int dst_fd, unsigned dst_offset,
+                    unsigned length);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
@@ -177,6 +177,11 @@ sub compare_output {
 			&& !/^ esi=.* edi=.* esp=.* ebp=.*/
 			&& !/^ cs=.* ds=.* es=.* ss=.*/, @output);
     }
+    my $ignore_benchmarks = exists $options{IGNORE_BENCHMARKS};
+    if ($ignore_benchmarks) {
+	delete $options{IGNORE_BENCHMARKS};
+	@output = grep (!/^\([^)]+\) bench: /, @output);
+    }
     die "unknown option " . (keys (%options))[0] . "\n" if %options;
 
     my ($msg);
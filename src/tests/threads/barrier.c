@@ -0,0 +1,73 @@
+/* Checks that a barrier holds every thread back until all of
+   them have arrived, that it can be reused for several rounds,
+   and that barrier_wait() returns true in exactly one thread
+   per round. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 5
+#define ROUND_CNT 4
+
+static thread_func barrier_thread;
+static void do_rounds(void);
+static void count(int*);
+
+static struct barrier barrier;
+static int arrived[ROUND_CNT];   /* Threads that reached each round. */
+static int serial[ROUND_CNT];    /* Threads that got true each round. */
+static int early_cnt;            /* Times a thread got through early. */
+
+void test_barrier(void) {
+  int i;
+
+  /* Main thread takes part too. */
+  barrier_init(&barrier, THREAD_CNT + 1);
+  for (i = 0; i < THREAD_CNT; i++) {
+    char name[16];
+    snprintf(name, sizeof name, "barrier %d", i);
+    thread_create(name, PRI_DEFAULT, barrier_thread, NULL);
+  }
+  do_rounds();
+
+  /* One more round so that every thread has finished checking. */
+  barrier_wait(&barrier);
+
+  for (i = 0; i < ROUND_CNT; i++)
+    if (serial[i] != 1)
+      fail("round %d: %d threads got true from barrier_wait()", i, serial[i]);
+  if (early_cnt != 0)
+    fail("%d threads passed the barrier too early", early_cnt);
+  msg("%d threads passed %d barriers together.", THREAD_CNT + 1, ROUND_CNT);
+}
+
+static void barrier_thread(void* aux UNUSED) {
+  do_rounds();
+  barrier_wait(&barrier);
+}
+
+static void do_rounds(void) {
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++) {
+    count(&arrived[i]);
+
+    /* Give other threads a chance to run ahead. */
+    thread_yield();
+    if (barrier_wait(&barrier))
+      count(&serial[i]);
+    if (arrived[i] != THREAD_CNT + 1)
+      count(&early_cnt);
+  }
+}
+
+/* Atomically increments *CNT. */
+static void count(int* cnt) {
+  enum intr_level old_level = intr_disable();
+  (*cnt)++;
+  intr_set_level(old_level);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(barrier) begin
+(barrier) 6 threads passed 4 barriers together.
+(barrier) end
+EOF
+pass;
@@ -0,0 +1,94 @@
+/* Fills 1M-bit bitmaps to various levels with random runs of set
+   bits, then searches them for runs of clear bits of various
+   lengths, once without and once with the free-run summary.
+   Checks that both searches agree and that each result really is
+   a free run, and reports the average cycles per search. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include <tsc.h>
+#include "tests/threads/tests.h"
+
+#define BIT_CNT (1024 * 1024) /* Bits per map. */
+#define SCAN_CNT 64           /* Searches per run length. */
+
+static const int fill_pcts[] = {0, 50, 90, 99};
+static const size_t run_lengths[] = {1, 16, 256, 4096};
+
+static void fill(struct bitmap*, struct bitmap*, int pct);
+static uint64_t time_scans(struct bitmap*, size_t cnt, size_t results[]);
+
+void test_bitmap_scan(void) {
+  struct bitmap* plain = bitmap_create(BIT_CNT);
+  struct bitmap* summed = bitmap_create(BIT_CNT);
+  static size_t plain_res[SCAN_CNT], summed_res[SCAN_CNT];
+  size_t f, l, i;
+
+  if (plain == NULL || summed == NULL || !bitmap_enable_summary(summed))
+    fail("out of memory");
+
+  for (f = 0; f < sizeof fill_pcts / sizeof *fill_pcts; f++) {
+    fill(plain, summed, fill_pcts[f]);
+    for (l = 0; l < sizeof run_lengths / sizeof *run_lengths; l++) {
+      size_t cnt = run_lengths[l];
+      uint64_t plain_cycles, summed_cycles;
+
+      random_init(l);
+      plain_cycles = time_scans(plain, cnt, plain_res);
+      random_init(l);
+      summed_cycles = time_scans(summed, cnt, summed_res);
+
+      for (i = 0; i < SCAN_CNT; i++) {
+        if (plain_res[i] != summed_res[i])
+          fail("%d%% full, %zu bits: scan results differ", fill_pcts[f], cnt);
+        if (plain_res[i] != BITMAP_ERROR && bitmap_any(plain, plain_res[i], cnt))
+          fail("%d%% full, %zu bits: scan returned a used bit", fill_pcts[f], cnt);
+      }
+      msg("bench: %d%% full, %zu bits: %llu cycles plain, %llu cycles with summary",
+          fill_pcts[f], cnt, plain_cycles / SCAN_CNT, summed_cycles / SCAN_CNT);
+    }
+  }
+  msg("Plain and summarized scans agree.");
+
+  bitmap_destroy(plain);
+  bitmap_destroy(summed);
+}
+
+/* Clears A and B, then sets random runs of 1 to 64 bits in both
+   until about PCT percent of the bits are set. */
+static void fill(struct bitmap* a, struct bitmap* b, int pct) {
+  size_t target = (size_t)BIT_CNT / 100 * pct;
+  size_t set = 0;
+
+  bitmap_set_all(a, false);
+  bitmap_set_all(b, false);
+  random_init(pct);
+  while (set < target) {
+    size_t start = random_ulong() % BIT_CNT;
+    size_t cnt = random_ulong() % 64 + 1;
+
+    if (start + cnt > BIT_CNT)
+      cnt = BIT_CNT - start;
+    set += bitmap_count(a, start, cnt, false);
+    bitmap_set_multiple(a, start, cnt, true);
+    bitmap_set_multiple(b, start, cnt, true);
+  }
+}
+
+/* Searches B for CNT clear bits SCAN_CNT times from random
+   starting points, storing the results in RESULTS[].  Returns
+   the total number of cycles taken. */
+static uint64_t time_scans(struct bitmap* b, size_t cnt, size_t results[]) {
+  uint64_t cycles = 0;
+  size_t i;
+
+  for (i = 0; i < SCAN_CNT; i++) {
+    size_t start = random_ulong() % BIT_CNT;
+    uint64_t t0 = rdtsc();
+
+    results[i] = bitmap_scan(b, start, cnt, false);
+    cycles += rdtsc() - t0;
+  }
+  return cycles;
+}
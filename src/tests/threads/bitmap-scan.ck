@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(bitmap-scan) begin
+(bitmap-scan) Plain and summarized scans agree.
+(bitmap-scan) end
+EOF
+pass;
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(kmap-tlb) begin
+(kmap-tlb) Read every page of RAM through the kernel map.
+(kmap-tlb) end
+EOF
+pass;
@@ -2,7 +2,7 @@
 use strict;
 use warnings;
 use tests::tests;
-check_expected ([<<'EOF']);
+check_expected (IGNORE_BENCHMARKS => 1, [<<'EOF']);
 (mt-matmul-16) begin
 (mt-matmul-16) Executing blocked matmul with 16 threads...
 (mt-matmul-16) Matrix results match expected values.
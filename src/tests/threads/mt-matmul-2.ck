@@ -2,7 +2,7 @@
 use strict;
 use warnings;
 use tests::tests;
-check_expected ([<<'EOF']);
+check_expected (IGNORE_BENCHMARKS => 1, [<<'EOF']);
 (mt-matmul-2) begin
 (mt-matmul-2) Executing blocked matmul with 2 threads...
 (mt-matmul-2) Matrix results match expected values.
@@ -2,7 +2,7 @@
 use strict;
 use warnings;
 use tests::tests;
-check_expected ([<<'EOF']);
+check_expected (IGNORE_BENCHMARKS => 1, [<<'EOF']);
 (mt-matmul-4) begin
 (mt-matmul-4) Executing blocked matmul with 4 threads...
 (mt-matmul-4) Matrix results match expected values.
@@ -1,70 +1,88 @@
 /* Simple implementation of a C = C + AxB matrix multiplication,
-   where A, B, and C are NxN matrices. */
+   where A, B, and C are NxN matrices.
+
+   The multiplication is done once row by row in the calling
+   thread and then again with parallel_for(), split into
+   NUM_THREADS blocks of rows.  Both results are verified and
+   the cycle counts of both passes are reported. */
 
 /* Based on UC Berkeley's RISC-V benchmark of the same name:
    https://github.com/ucb-bar/riscv-benchmarks/tree/master/mt-matmul */
 
 #include <stdio.h>
+#include <string.h>
+#include <tsc.h>
 #include "tests/threads/tests.h"
 #include "tests/threads/matmul_data.h"
 #include "threads/init.h"
-#include "threads/synch.h"
+#include "threads/parallel.h"
 #include "threads/thread.h"
 
-void __attribute__((noinline)) matmul(const int tid, const int nthreads, const int lda,
-                                      const short A[], const short B[], short C[]);
+/* Number of times each pass is repeated for timing. */
+#define ROUNDS 8
+
+void __attribute__((noinline)) matmul(size_t begin, size_t end, void* aux);
 void test_mt_matmul(size_t num_threads);
-void thread_entry(void* aux);
 
 static short results_data[ARRAY_SIZE];
 
-struct thread_args {
-  int tid;
-  int n_threads;
-};
-
-void __attribute__((noinline)) matmul(const int tid, const int nthreads, const int lda,
-                                      const short A[], const short B[], short C[]) {
-  int i, j, k;
-  int block = lda / nthreads;
-  int start = block * tid;
+/* Computes rows [BEGIN, END) of C = C + AxB. */
+void __attribute__((noinline)) matmul(size_t begin, size_t end, void* aux UNUSED) {
+  const int lda = DIM_SIZE;
+  size_t j;
+  int i, k;
 
-  for (j = start; j < (start + block); j++)
+  for (j = begin; j < end; j++)
     for (k = 0; k < lda; k++)
       for (i = 0; i < lda; i++)
-        C[i + j * lda] += A[j * lda + k] * B[k * lda + i];
+        results_data[i + j * lda] += input1_data[j * lda + k] * input2_data[k * lda + i];
 }
 
-void thread_entry(void* aux) {
-  struct thread_args* args = (struct thread_args*)aux;
-
-  matmul(args->tid, args->n_threads, DIM_SIZE, input1_data, input2_data, results_data);
+/* Runs ROUNDS multiplications and returns the total number of
+   cycles.  If GRAIN is 0, runs serially in this thread,
+   otherwise uses parallel_for() with the given GRAIN. */
+static uint64_t run_matmul(size_t grain, bool* ok) {
+  uint64_t cycles = 0;
+  int r;
+
+  *ok = true;
+  for (r = 0; r < ROUNDS; r++) {
+    uint64_t start;
+
+    memset(results_data, 0, sizeof results_data);
+    start = rdtsc();
+    if (grain == 0)
+      matmul(0, DIM_SIZE, NULL);
+    else
+      parallel_for(0, DIM_SIZE, grain, matmul, NULL);
+    cycles += rdtsc() - start;
+
+    if (!verifyDouble(ARRAY_SIZE, results_data, verify_data))
+      *ok = false;
+  }
+  return cycles;
 }
 
 void test_mt_matmul(size_t num_threads) {
+  uint64_t serial, parallel;
+  bool serial_ok, parallel_ok;
+
   ASSERT(active_sched_policy == SCHED_PRIO);
 
   /* Make sure our priority is the default. */
   ASSERT(thread_get_priority() == PRI_DEFAULT);
 
-  struct thread_args args[num_threads];
-  for (size_t i = 0; i < num_threads; i++) {
-    args[i].tid = i;
-    args[i].n_threads = num_threads;
+  serial = run_matmul(0, &serial_ok);
+  parallel = run_matmul(DIM_SIZE / num_threads, &parallel_ok);
 
-    thread_create("matmul", PRI_DEFAULT - 1, thread_entry, (void*)&args[i]);
-  }
-
-  /* Let other threads run to completion */
-  thread_set_priority(PRI_DEFAULT - 2);
-
-  int res = verifyDouble(ARRAY_SIZE, results_data, verify_data);
-
-  if (res) {
+  if (serial_ok && parallel_ok) {
     msg("Matrix results match expected values.");
   } else {
     msg("Matrix results do not match expected values!");
   }
+
+  msg("bench: serial %llu cycles/matmul", serial / ROUNDS);
+  msg("bench: parallel_for (%zu blocks) %llu cycles/matmul", num_threads, parallel / ROUNDS);
 }
 
 void test_mt_matmul_1(void) {
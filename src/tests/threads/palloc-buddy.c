@@ -0,0 +1,86 @@
+/* Allocates and frees a random mix of 1 to 64 page blocks from
+   the user pool, checking that no two live blocks overlap, and
+   reports the average cost of palloc_get_multiple() and
+   palloc_free_multiple(). */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <tsc.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define SLOT_CNT 8      /* Blocks live at a time. */
+#define ITER_CNT 4000   /* Allocations to perform. */
+#define MAX_PAGES 64    /* Largest block. */
+
+struct block {
+  uint32_t* pages; /* First page, or NULL if slot is empty. */
+  size_t page_cnt; /* Number of pages. */
+};
+
+static struct block blocks[SLOT_CNT];
+
+static void fill_block(struct block*, uint32_t tag);
+static void check_block(const struct block*, uint32_t tag);
+
+void test_palloc_buddy(void) {
+  uint64_t alloc_cycles = 0, free_cycles = 0;
+  int alloc_cnt = 0, free_cnt = 0, fail_cnt = 0;
+  int i;
+
+  random_init(0x5eed);
+  for (i = 0; i < ITER_CNT; i++) {
+    struct block* b = &blocks[random_ulong() % SLOT_CNT];
+    uint64_t start;
+
+    if (b->pages != NULL) {
+      check_block(b, b - blocks);
+      start = rdtsc();
+      palloc_free_multiple(b->pages, b->page_cnt);
+      free_cycles += rdtsc() - start;
+      free_cnt++;
+      b->pages = NULL;
+    }
+
+    b->page_cnt = random_ulong() % MAX_PAGES + 1;
+    start = rdtsc();
+    b->pages = palloc_get_multiple(PAL_USER, b->page_cnt);
+    alloc_cycles += rdtsc() - start;
+    if (b->pages != NULL) {
+      fill_block(b, b - blocks);
+      alloc_cnt++;
+    } else
+      fail_cnt++;
+  }
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (blocks[i].pages != NULL) {
+      check_block(&blocks[i], i);
+      palloc_free_multiple(blocks[i].pages, blocks[i].page_cnt);
+    }
+
+  msg("Allocated and freed blocks of 1 to %d pages.", MAX_PAGES);
+  msg("bench: %d allocs, %llu cycles/alloc", alloc_cnt,
+      alloc_cnt ? alloc_cycles / alloc_cnt : 0);
+  msg("bench: %d frees, %llu cycles/free", free_cnt, free_cnt ? free_cycles / free_cnt : 0);
+  msg("bench: %d requests failed", fail_cnt);
+}
+
+/* Stamps every page of B with TAG. */
+static void fill_block(struct block* b, uint32_t tag) {
+  size_t i;
+
+  for (i = 0; i < b->page_cnt; i++)
+    b->pages[i * PGSIZE / sizeof *b->pages] = tag;
+}
+
+/* Checks that no other block has overwritten B. */
+static void check_block(const struct block* b, uint32_t tag) {
+  size_t i;
+
+  for (i = 0; i < b->page_cnt; i++)
+    if (b->pages[i * PGSIZE / sizeof *b->pages] != tag)
+      fail("page %zu of block %" PRIu32 " was overwritten", i, tag);
+}
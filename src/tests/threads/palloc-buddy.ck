@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Allocated and freed blocks of 1 to 64 pages.
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,86 @@
+/* Checks that palloc_get_page(PAL_ZERO) returns zeroed pages
+   whether or not the idle thread has pre-zeroed any, and reports
+   the average cycles per allocation right after an idle period
+   (pre-zeroed pool full) and after draining the pool, as well as
+   the cost of thread_create(). */
+
+#include <stdio.h>
+#include <string.h>
+#include <tsc.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+#define BATCH 8     /* Pages timed per measurement. */
+#define DRAIN 64    /* Pages that certainly empty the pre-zeroed pool. */
+#define ROUNDS 4
+
+static void* drained[DRAIN];
+
+static uint64_t time_batch(void* pages[BATCH]);
+static void check_and_free(void* pages[BATCH]);
+static void nothing(void* aux UNUSED) {}
+
+void test_palloc_zero(void) {
+  uint64_t warm = 0, cold = 0, create = 0;
+  void* pages[BATCH];
+  int r, i;
+
+  for (r = 0; r < ROUNDS; r++) {
+    /* Give the idle thread time to refill the pool. */
+    timer_sleep(10);
+    warm += time_batch(pages);
+    check_and_free(pages);
+
+    /* Same thing with the pool emptied. */
+    for (i = 0; i < DRAIN; i++)
+      drained[i] = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+    cold += time_batch(pages);
+    check_and_free(pages);
+    for (i = 0; i < DRAIN; i++)
+      palloc_free_page(drained[i]);
+
+    timer_sleep(10);
+    for (i = 0; i < BATCH; i++) {
+      uint64_t start = rdtsc();
+      thread_create("nothing", PRI_MIN, nothing, NULL);
+      create += rdtsc() - start;
+    }
+  }
+  timer_sleep(10);
+
+  msg("All PAL_ZERO pages were zeroed.");
+  msg("bench: PAL_ZERO after idle %llu cycles/page", warm / ROUNDS / BATCH);
+  msg("bench: PAL_ZERO with pool drained %llu cycles/page", cold / ROUNDS / BATCH);
+  msg("bench: thread_create %llu cycles", create / ROUNDS / BATCH);
+}
+
+/* Allocates BATCH zeroed pages into PAGES and returns the cycles
+   spent. */
+static uint64_t time_batch(void* pages[BATCH]) {
+  uint64_t start = rdtsc();
+  int i;
+
+  for (i = 0; i < BATCH; i++)
+    pages[i] = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+  return rdtsc() - start;
+}
+
+/* Checks that each page in PAGES is all zeros, dirties it so a
+   stale pre-zeroed page would be noticed later, and frees it. */
+static void check_and_free(void* pages[BATCH]) {
+  int i;
+
+  for (i = 0; i < BATCH; i++) {
+    const uint8_t* p = pages[i];
+    size_t j;
+
+    for (j = 0; j < PGSIZE; j++)
+      if (p[j] != 0)
+        fail("byte %zu of a PAL_ZERO page is %#x", j, p[j]);
+    memset(pages[i], 0x5a, PGSIZE);
+    palloc_free_page(pages[i]);
+  }
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) All PAL_ZERO pages were zeroed.
+(palloc-zero) end
+EOF
+pass;
@@ -2,7 +2,7 @@
 use strict;
 use warnings;
 use tests::tests;
-check_expected ([<<'EOF']);
+check_expected (IGNORE_BENCHMARKS => 1, [<<'EOF']);
 (st-matmul) begin
 (st-matmul) Executing single-threaded matmul...
 (st-matmul) Matrix results match expected values.
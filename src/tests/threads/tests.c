@@ -28,6 +28,11 @@ static const struct test threads_tests[] = {
     {"mt-matmul-2", test_mt_matmul_2},
     {"mt-matmul-4", test_mt_matmul_4},
     {"mt-matmul-16", test_mt_matmul_16},
+    {"barrier", test_barrier},
+    {"palloc-buddy", test_palloc_buddy},
+    {"bitmap-scan", test_bitmap_scan},
+    {"kmap-tlb", test_kmap_tlb},
+    {"palloc-zero", test_palloc_zero},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -29,6 +29,11 @@ extern test_func test_mt_matmul_1;
 extern test_func test_mt_matmul_2;
 extern test_func test_mt_matmul_4;
 extern test_func test_mt_matmul_16;
+extern test_func test_barrier;
+extern test_func test_palloc_buddy;
+extern test_func test_bitmap_scan;
+extern test_func test_kmap_tlb;
+extern test_func test_palloc_zero;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,92 @@
+/* Copies a multi-megabyte file twice, once the way examples/cp
+   used to, through a user buffer with read() and write(), and
+   once with a single copy_file_range() that keeps the data in
+   the kernel.  Checks both copies and reports the cost per
+   kilobyte of each.  Also checks an unaligned copy and the error
+   cases. */
+
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define BLOCK 4096
+#define CP_CHUNK 1024
+
+static char buf[BLOCK];
+
+/* Returns the byte expected at OFS in "source". */
+static char expected(int ofs) { return ofs / BLOCK * 13 + ofs % 251; }
+
+/* Checks that LENGTH bytes of NAME starting at OFS match
+   "source" starting at SRC_OFS. */
+static void check_copy(const char* name, int ofs, int src_ofs, int length) {
+  int handle, i;
+
+  CHECK((handle = open(name)) > 1, "open \"%s\"", name);
+  while (length > 0) {
+    int chunk = length < BLOCK ? length : BLOCK;
+
+    if (pread(handle, buf, chunk, ofs) != chunk)
+      fail("pread \"%s\" failed at %d", name, ofs);
+    for (i = 0; i < chunk; i++)
+      if (buf[i] != expected(src_ofs + i))
+        fail("\"%s\" differs from \"source\" at %d", name, ofs + i);
+    ofs += chunk;
+    src_ofs += chunk;
+    length -= chunk;
+  }
+  msg("\"%s\" matches \"source\"", name);
+  close(handle);
+}
+
+void test_main(void) {
+  uint64_t start, rw, range;
+  int src, dst, ofs, i;
+
+  CHECK(create("source", SIZE), "create \"source\"");
+  CHECK((src = open("source")) > 1, "open \"source\"");
+  for (ofs = 0; ofs < SIZE; ofs += BLOCK) {
+    for (i = 0; i < BLOCK; i++)
+      buf[i] = expected(ofs + i);
+    if (write(src, buf, BLOCK) != BLOCK)
+      fail("write \"source\" failed at %d", ofs);
+  }
+  msg("write \"source\"");
+
+  /* Through user memory, CP_CHUNK bytes per read() and write(). */
+  CHECK(create("copy-rw", SIZE), "create \"copy-rw\"");
+  CHECK((dst = open("copy-rw")) > 1, "open \"copy-rw\"");
+  seek(src, 0);
+  start = rdtsc();
+  for (ofs = 0; ofs < SIZE; ofs += CP_CHUNK)
+    if (read(src, buf, CP_CHUNK) != CP_CHUNK || write(dst, buf, CP_CHUNK) != CP_CHUNK)
+      fail("read/write copy failed at %d", ofs);
+  rw = rdtsc() - start;
+  close(dst);
+  check_copy("copy-rw", 0, 0, SIZE);
+
+  /* Inside the kernel. */
+  CHECK(create("copy-range", SIZE), "create \"copy-range\"");
+  CHECK((dst = open("copy-range")) > 1, "open \"copy-range\"");
+  start = rdtsc();
+  if (copy_file_range(src, 0, dst, 0, SIZE) != SIZE)
+    fail("copy_file_range() copied short");
+  range = rdtsc() - start;
+  CHECK(tell(dst) == 0, "file position unchanged");
+  check_copy("copy-range", 0, 0, SIZE);
+
+  CHECK(copy_file_range(src, 100, dst, 7, 3000) == 3000, "unaligned copy_file_range");
+  check_copy("copy-range", 7, 100, 3000);
+  CHECK(copy_file_range(src, SIZE - 10, dst, 0, 100) == 10, "copy stops at end of file");
+  CHECK(copy_file_range(dst, 0, dst, 100, 1000) == -1, "overlapping ranges fail");
+  CHECK(copy_file_range(dst, 0x7fffff00, dst, 0x7fffff10, 0x7fffffff) == -1,
+        "overlapping ranges near INT_MAX fail");
+  CHECK(copy_file_range(1234, 0, dst, 0, 10) == -1, "bad fd fails");
+  close(src);
+  close(dst);
+
+  msg("bench: %d KB copy: %llu cycles/KB with read+write, %llu with copy_file_range", SIZE / 1024,
+      rw / (SIZE / 1024), range / (SIZE / 1024));
+}
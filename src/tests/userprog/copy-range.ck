@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(copy-range) begin
+(copy-range) create "source"
+(copy-range) open "source"
+(copy-range) write "source"
+(copy-range) create "copy-rw"
+(copy-range) open "copy-rw"
+(copy-range) open "copy-rw"
+(copy-range) "copy-rw" matches "source"
+(copy-range) create "copy-range"
+(copy-range) open "copy-range"
+(copy-range) file position unchanged
+(copy-range) open "copy-range"
+(copy-range) "copy-range" matches "source"
+(copy-range) unaligned copy_file_range
+(copy-range) open "copy-range"
+(copy-range) "copy-range" matches "source"
+(copy-range) copy stops at end of file
+(copy-range) overlapping ranges fail
+(copy-range) overlapping ranges near INT_MAX fail
+(copy-range) bad fd fails
+(copy-range) end
+EOF
+pass;
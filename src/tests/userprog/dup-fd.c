@@ -0,0 +1,57 @@
+/* Checks that open() hands out the lowest free descriptor, that
+   dup() and dup2() share the file position with the original,
+   and that descriptors stay usable after the one they were
+   duplicated from is closed.  Checks that the console descriptors
+   can be neither duplicated nor replaced and that the console
+   still works afterward.  Then opens many files and reports
+   the cost of a filesize() call on the last one. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define MANY 200
+#define CALLS 1000
+
+void test_main(void) {
+  int a, b, c, d, i, last;
+  uint64_t start, cycles;
+  char buf[8];
+
+  CHECK((a = open("sample.txt")) == 2, "open \"sample.txt\" as fd 2");
+  CHECK((b = dup(a)) == 3, "dup to fd 3");
+  CHECK(read(a, buf, 5) == 5, "read 5 bytes through fd 2");
+  CHECK(tell(b) == 5, "position shared with fd 3");
+
+  CHECK((d = dup2(b, 10)) == 10, "dup2 to fd 10");
+  close(a);
+  close(b);
+  CHECK(read(d, buf, 3) == 3 && buf[0] == sample[5], "read through fd 10 after close");
+
+  CHECK((c = open("sample.txt")) == 2, "reopen reuses fd 2");
+  CHECK(tell(c) == 0, "new open has its own position");
+  CHECK(dup(99) == -1, "dup of a closed fd fails");
+  CHECK(dup2(c, -1) == -1, "dup2 to a bad fd fails");
+
+  CHECK(dup(STDIN_FILENO) == -1 && dup(STDOUT_FILENO) == -1, "dup of the console fails");
+  CHECK(dup2(STDOUT_FILENO, 20) == -1, "dup2 from the console fails");
+  CHECK(dup2(c, STDIN_FILENO) == -1 && dup2(c, STDOUT_FILENO) == -1,
+        "dup2 onto the console fails");
+  CHECK(write(STDOUT_FILENO, "", 0) == 0, "console still writable");
+  CHECK(tell(c) == 0, "fd 2 still open and unchanged");
+
+  for (i = 0; i < MANY; i++)
+    if ((last = open("sample.txt")) < 0)
+      fail("open #%d failed", i);
+  msg("open %d more files", MANY);
+
+  start = rdtsc();
+  for (i = 0; i < CALLS; i++)
+    if (filesize(last) != sizeof sample - 1)
+      fail("filesize() failed");
+  cycles = rdtsc() - start;
+  msg("bench: filesize() on fd %d of %d open: %llu cycles/call", last, MANY + 2, cycles / CALLS);
+}
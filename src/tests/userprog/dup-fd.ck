@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(dup-fd) begin
+(dup-fd) open "sample.txt" as fd 2
+(dup-fd) dup to fd 3
+(dup-fd) read 5 bytes through fd 2
+(dup-fd) position shared with fd 3
+(dup-fd) dup2 to fd 10
+(dup-fd) read through fd 10 after close
+(dup-fd) reopen reuses fd 2
+(dup-fd) new open has its own position
+(dup-fd) dup of a closed fd fails
+(dup-fd) dup2 to a bad fd fails
+(dup-fd) dup of the console fails
+(dup-fd) dup2 from the console fails
+(dup-fd) dup2 onto the console fails
+(dup-fd) console still writable
+(dup-fd) fd 2 still open and unchanged
+(dup-fd) open 200 more files
+(dup-fd) end
+EOF
+pass;
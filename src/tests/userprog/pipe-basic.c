@@ -0,0 +1,57 @@
+/* Exercises a pipe within a single process: short writes and
+   reads, vectored I/O, whole pages written from and read into
+   page-aligned buffers, end of file once the write end is closed,
+   and a failed write once the read end is closed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+
+static char pages[4][PAGE] __attribute__((aligned(PAGE)));
+
+void test_main(void) {
+  struct iovec iov[2];
+  char buf[16];
+  int fds[2], i;
+
+  CHECK(pipe(fds) == 0, "pipe");
+  CHECK(write(fds[1], "hello, ", 7) == 7 && write(fds[1], "world", 5) == 5, "write 12 bytes");
+  CHECK(read(fds[0], buf, 5) == 5 && !memcmp(buf, "hello", 5), "read 5 bytes");
+  CHECK(read(fds[0], buf, sizeof buf) == 7 && !memcmp(buf, ", world", 7),
+        "read returns what is left");
+  CHECK(write(fds[0], "x", 1) == -1 && read(fds[1], buf, 1) == -1, "ends are one-way");
+
+  iov[0] = (struct iovec){"head", 4};
+  iov[1] = (struct iovec){"-tail", 5};
+  CHECK(writev(fds[1], iov, 2) == 9, "writev 2 buffers");
+  iov[0] = (struct iovec){buf, 4};
+  iov[1] = (struct iovec){buf + 4, 12};
+  CHECK(readv(fds[0], iov, 2) == 9 && !memcmp(buf, "head-tail", 9), "readv 2 buffers");
+
+  /* The writer's pages must keep their contents, and the reader
+     must see them as they were when written, even if the writer
+     changes them afterward. */
+  memset(pages[0], 'a', PAGE);
+  memset(pages[1], 'b', PAGE);
+  CHECK(write(fds[1], pages[0], 2 * PAGE) == 2 * PAGE, "write 2 pages");
+  memset(pages[0], 'z', PAGE);
+  CHECK(read(fds[0], pages[2], 2 * PAGE) == 2 * PAGE, "read 2 pages");
+  for (i = 0; i < PAGE; i++)
+    if (pages[2][i] != 'a' || pages[3][i] != 'b' || pages[0][i] != 'z' || pages[1][i] != 'b')
+      fail("page contents wrong at byte %d", i);
+  pages[3][0] = 'c';
+  CHECK(pages[1][0] == 'b', "pages read back match");
+
+  close(fds[1]);
+  CHECK(read(fds[0], buf, sizeof buf) == 0, "end of file after write end closed");
+  close(fds[0]);
+
+  CHECK(pipe(fds) == 0, "pipe");
+  close(fds[0]);
+  CHECK(write(fds[1], "x", 1) == -1, "write fails after read end closed");
+  CHECK(filesize(fds[1]) == -1 && pread(fds[1], buf, 1, 0) == -1, "file calls fail on a pipe");
+  close(fds[1]);
+}
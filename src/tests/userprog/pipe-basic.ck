@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-basic) begin
+(pipe-basic) pipe
+(pipe-basic) write 12 bytes
+(pipe-basic) read 5 bytes
+(pipe-basic) read returns what is left
+(pipe-basic) ends are one-way
+(pipe-basic) writev 2 buffers
+(pipe-basic) readv 2 buffers
+(pipe-basic) write 2 pages
+(pipe-basic) read 2 pages
+(pipe-basic) pages read back match
+(pipe-basic) end of file after write end closed
+(pipe-basic) pipe
+(pipe-basic) write fails after read end closed
+(pipe-basic) file calls fail on a pipe
+(pipe-basic) end
+pipe-basic: exit(0)
+EOF
+pass;
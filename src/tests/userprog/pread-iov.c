@@ -0,0 +1,96 @@
+/* Writes a file of fixed-size records, each a header and a
+   payload, with a single writev(), reads individual records back
+   with pread() and pwrite() without disturbing the file position,
+   and reads the whole file back with readv().  Reports the cost
+   of reading scattered records with seek() and read() against
+   pread(). */
+
+#include <string.h>
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RECORDS 16
+#define PAYLOAD 496
+#define ROUNDS 8
+
+struct header {
+  int index;
+  int length;
+  char tag[8];
+};
+
+struct record {
+  struct header header;
+  char payload[PAYLOAD];
+};
+
+static struct record records[RECORDS];
+static struct record copy[RECORDS];
+static struct iovec iov[RECORDS * 2];
+
+/* Points IOV at the headers and payloads of RECS in turn. */
+static void fill_iov(struct record* recs) {
+  int i;
+
+  for (i = 0; i < RECORDS; i++) {
+    iov[i * 2] = (struct iovec){&recs[i].header, sizeof recs[i].header};
+    iov[i * 2 + 1] = (struct iovec){recs[i].payload, PAYLOAD};
+  }
+}
+
+void test_main(void) {
+  struct record r;
+  uint64_t start, seek_read = 0, positional = 0;
+  int handle, i, round;
+
+  for (i = 0; i < RECORDS; i++) {
+    records[i].header = (struct header){i, PAYLOAD, "record"};
+    memset(records[i].payload, 'a' + i, PAYLOAD);
+  }
+
+  CHECK(create("records", sizeof records), "create \"records\"");
+  CHECK((handle = open("records")) > 1, "open \"records\"");
+  fill_iov(records);
+  CHECK(writev(handle, iov, RECORDS * 2) == sizeof records, "writev %d buffers", RECORDS * 2);
+  CHECK(tell(handle) == sizeof records, "position advanced past the records");
+
+  seek(handle, 100);
+  CHECK(pread(handle, &r, sizeof r, 5 * sizeof r) == sizeof r, "pread record 5");
+  if (r.header.index != 5 || memcmp(r.payload, records[5].payload, PAYLOAD))
+    fail("record 5 read back wrong");
+  memset(records[3].payload, 'Z', PAYLOAD);
+  CHECK(pwrite(handle, records[3].payload, PAYLOAD, 3 * sizeof r + sizeof r.header) == PAYLOAD,
+        "pwrite payload of record 3");
+  CHECK(tell(handle) == 100, "position unchanged");
+
+  seek(handle, 0);
+  fill_iov(copy);
+  CHECK(readv(handle, iov, RECORDS * 2) == sizeof copy, "readv %d buffers", RECORDS * 2);
+  if (memcmp(copy, records, sizeof records))
+    fail("records read back wrong");
+  msg("records match");
+
+  CHECK(pread(handle, &r, sizeof r, sizeof records) == 0, "pread at end of file");
+  CHECK(pread(1234, &r, sizeof r, 0) == -1, "pread of a bad fd fails");
+  CHECK(readv(handle, iov, IOV_MAX + 1) == -1, "readv of too many buffers fails");
+
+  for (round = 0; round < ROUNDS; round++)
+    for (i = 0; i < RECORDS; i++) {
+      int index = (i * 7) % RECORDS;
+
+      start = rdtsc();
+      seek(handle, index * sizeof r);
+      read(handle, &r, sizeof r.header);
+      seek_read += rdtsc() - start;
+
+      start = rdtsc();
+      pread(handle, &r, sizeof r.header, index * sizeof r);
+      positional += rdtsc() - start;
+    }
+  close(handle);
+
+  msg("bench: scattered header reads: %llu cycles with seek+read, %llu with pread",
+      seek_read / (ROUNDS * RECORDS), positional / (ROUNDS * RECORDS));
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(pread-iov) begin
+(pread-iov) create "records"
+(pread-iov) open "records"
+(pread-iov) writev 32 buffers
+(pread-iov) position advanced past the records
+(pread-iov) pread record 5
+(pread-iov) pwrite payload of record 3
+(pread-iov) position unchanged
+(pread-iov) readv 32 buffers
+(pread-iov) records match
+(pread-iov) pread at end of file
+(pread-iov) pread of a bad fd fails
+(pread-iov) readv of too many buffers fails
+(pread-iov) end
+EOF
+pass;
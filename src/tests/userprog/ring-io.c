@@ -0,0 +1,121 @@
+/* Writes a file through the asynchronous I/O rings with many
+   requests in flight at once, reads it back the same way, and
+   checks the data and every completion.  Also checks that a bad
+   file descriptor or an offset beyond what a file offset can hold
+   completes with -1 and reports the cost of
+   reading the file with the rings and with read(). */
+
+#include <string.h>
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PIECE 512
+#define PIECES 32
+#define SIZE (PIECE * PIECES)
+
+static struct ring ring;
+static char data[SIZE];
+static char buf[SIZE];
+
+/* Queues a request. */
+static void queue(uint32_t op, int fd, void* buffer, uint32_t size, uint32_t offset,
+                  uint32_t user_data) {
+  struct ring_sqe* sqe = &ring.sq[ring.sq_tail % RING_ENTRIES];
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buffer = buffer;
+  sqe->size = size;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+/* Submits CNT queued requests, waits for all of them, and checks
+   that completion I has user data I and result EXPECTED.  The
+   completions may arrive in any order. */
+static void submit_and_reap(unsigned cnt, int32_t expected) {
+  bool seen[RING_ENTRIES];
+  unsigned i;
+
+  if (ring_enter(cnt, cnt) != (int)cnt)
+    fail("ring_enter() did not submit %u requests", cnt);
+  if (ring.cq_tail - ring.cq_head != cnt)
+    fail("%u completions instead of %u", ring.cq_tail - ring.cq_head, cnt);
+
+  memset(seen, 0, sizeof seen);
+  for (i = 0; i < cnt; i++) {
+    struct ring_cqe* cqe = &ring.cq[ring.cq_head++ % RING_ENTRIES];
+
+    if (cqe->user_data >= cnt || seen[cqe->user_data])
+      fail("bad user data %u", cqe->user_data);
+    seen[cqe->user_data] = true;
+    if (cqe->result != expected)
+      fail("request %u returned %d", cqe->user_data, cqe->result);
+  }
+}
+
+/* Reads the whole file with PIECES requests and returns the
+   cycles it took. */
+static uint64_t read_ring(int fd) {
+  uint64_t start = rdtsc();
+  int i;
+
+  for (i = 0; i < PIECES; i++)
+    queue(RING_OP_READ, fd, buf + i * PIECE, PIECE, i * PIECE, i);
+  submit_and_reap(PIECES, PIECE);
+  return rdtsc() - start;
+}
+
+/* Reads the whole file with read() a piece at a time and
+   returns the cycles it took. */
+static uint64_t read_sync(int fd) {
+  uint64_t start = rdtsc();
+  int i;
+
+  seek(fd, 0);
+  for (i = 0; i < PIECES; i++)
+    if (read(fd, buf + i * PIECE, PIECE) != PIECE)
+      fail("read() failed");
+  return rdtsc() - start;
+}
+
+void test_main(void) {
+  uint64_t ring_cycles, sync_cycles;
+  int fd, i;
+
+  for (i = 0; i < SIZE; i++)
+    data[i] = i * 13 + i / 509;
+  CHECK(create("data", SIZE), "create \"data\"");
+  CHECK((fd = open("data")) > 1, "open \"data\"");
+  CHECK(ring_setup(&ring), "ring_setup");
+
+  for (i = 0; i < PIECES; i++)
+    queue(RING_OP_WRITE, fd, data + i * PIECE, PIECE, i * PIECE, i);
+  submit_and_reap(PIECES, PIECE);
+  msg("write %d pieces", PIECES);
+
+  queue(RING_OP_FSYNC, fd, NULL, 0, 0, 0);
+  submit_and_reap(1, 0);
+  msg("fsync");
+
+  ring_cycles = read_ring(fd);
+  if (memcmp(buf, data, SIZE))
+    fail("data read through the ring differs");
+  msg("read %d pieces", PIECES);
+
+  queue(RING_OP_READ, 1234, buf, PIECE, 0, 0);
+  submit_and_reap(1, -1);
+  msg("bad fd completes with -1");
+
+  queue(RING_OP_READ, fd, buf, PIECE, 0x80000000u, 0);
+  queue(RING_OP_WRITE, fd, data, PIECE, 0x7fffffffu - PIECE / 2, 1);
+  submit_and_reap(2, -1);
+  msg("out-of-range offset completes with -1");
+
+  sync_cycles = read_sync(fd);
+  msg("bench: %d-byte file in %d-byte pieces: %llu cycles with rings, %llu with read()", SIZE,
+      PIECE, ring_cycles, sync_cycles);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(ring-io) begin
+(ring-io) create "data"
+(ring-io) open "data"
+(ring-io) ring_setup
+(ring-io) write 32 pieces
+(ring-io) fsync
+(ring-io) read 32 pieces
+(ring-io) bad fd completes with -1
+(ring-io) out-of-range offset completes with -1
+(ring-io) end
+EOF
+pass;
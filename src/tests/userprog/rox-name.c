@@ -0,0 +1,33 @@
+/* Checks that write-denial follows the running executable rather
+   than its name: files that merely share a name with a running
+   thread ("main", "idle") can still be written, while the
+   executable itself cannot. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void write_named(const char* name) {
+  int handle, byte_cnt;
+
+  CHECK(create(name, sizeof sample - 1), "create \"%s\"", name);
+  CHECK((handle = open(name)) > 1, "open \"%s\"", name);
+  byte_cnt = write(handle, sample, sizeof sample - 1);
+  if (byte_cnt != sizeof sample - 1)
+    fail("write() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  msg("wrote \"%s\"", name);
+  close(handle);
+}
+
+void test_main(void) {
+  int handle;
+  char buffer[16];
+
+  write_named("main");
+  write_named("idle");
+
+  CHECK((handle = open("rox-name")) > 1, "open \"rox-name\"");
+  CHECK(read(handle, buffer, sizeof buffer) == (int)sizeof buffer, "read \"rox-name\"");
+  CHECK(write(handle, buffer, sizeof buffer) == 0, "try to write \"rox-name\"");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rox-name) begin
+(rox-name) create "main"
+(rox-name) open "main"
+(rox-name) wrote "main"
+(rox-name) create "idle"
+(rox-name) open "idle"
+(rox-name) wrote "idle"
+(rox-name) open "rox-name"
+(rox-name) read "rox-name"
+(rox-name) try to write "rox-name"
+(rox-name) end
+rox-name: exit(0)
+EOF
+pass;
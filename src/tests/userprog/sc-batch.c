@@ -0,0 +1,103 @@
+/* Copies a small file in CHUNK-byte pieces, once with a read()
+   and a write() system call per piece and once with all of the
+   pieces submitted through a single syscall_batch(), checks that
+   both copies match the original, and reports the cost of each
+   copy.  Also checks that BATCH_STOP_ON_ERROR stops at the first
+   failing call. */
+
+#include <string.h>
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 2048
+#define CHUNK 64
+#define CHUNKS (SIZE / CHUNK)
+#define ROUNDS 8
+
+static char data[SIZE];
+static char buf[SIZE];
+static struct syscall_entry batch[CHUNKS * 2];
+
+/* Copies SRC to DST a piece at a time with one trap per call. */
+static void copy_traps(int src, int dst) {
+  int i;
+
+  for (i = 0; i < CHUNKS; i++) {
+    if (read(src, buf + i * CHUNK, CHUNK) != CHUNK)
+      fail("read() failed");
+    if (write(dst, buf + i * CHUNK, CHUNK) != CHUNK)
+      fail("write() failed");
+  }
+}
+
+/* Copies SRC to DST a piece at a time with a single trap. */
+static void copy_batch(int src, int dst) {
+  struct syscall_entry* e = batch;
+  int i;
+
+  for (i = 0; i < CHUNKS; i++) {
+    *e++ = (struct syscall_entry){SYS_READ, {src, (uint32_t)(buf + i * CHUNK), CHUNK}, 0};
+    *e++ = (struct syscall_entry){SYS_WRITE, {dst, (uint32_t)(buf + i * CHUNK), CHUNK}, 0};
+  }
+  if (syscall_batch(batch, CHUNKS * 2, BATCH_STOP_ON_ERROR) != CHUNKS * 2)
+    fail("syscall_batch() stopped early");
+  for (i = 0; i < CHUNKS * 2; i++)
+    if (batch[i].result != CHUNK)
+      fail("batched call %d returned %d", i, batch[i].result);
+}
+
+/* Copies "source" to a new file NAME ROUNDS times with COPY,
+   checks the result, and returns the cycles per copy. */
+static uint64_t time_copy(const char* name, void (*copy)(int, int)) {
+  uint64_t cycles = 0;
+  int src, dst, r;
+
+  CHECK(create(name, SIZE), "create \"%s\"", name);
+  CHECK((src = open("source")) > 1, "open \"source\"");
+  CHECK((dst = open(name)) > 1, "open \"%s\"", name);
+  for (r = 0; r < ROUNDS; r++) {
+    uint64_t start;
+
+    seek(src, 0);
+    seek(dst, 0);
+    start = rdtsc();
+    copy(src, dst);
+    cycles += rdtsc() - start;
+  }
+
+  seek(dst, 0);
+  memset(buf, 0, sizeof buf);
+  if (read(dst, buf, SIZE) != SIZE || memcmp(buf, data, SIZE))
+    fail("\"%s\" differs from \"source\"", name);
+  msg("\"%s\" matches \"source\"", name);
+  close(src);
+  close(dst);
+  return cycles / ROUNDS;
+}
+
+void test_main(void) {
+  uint64_t traps, batched;
+  int handle, i;
+
+  for (i = 0; i < SIZE; i++)
+    data[i] = i * 7 + i / 251;
+  CHECK(create("source", SIZE), "create \"source\"");
+  CHECK((handle = open("source")) > 1, "open \"source\"");
+  CHECK(write(handle, data, SIZE) == SIZE, "write \"source\"");
+  close(handle);
+
+  traps = time_copy("copy-traps", copy_traps);
+  batched = time_copy("copy-batch", copy_batch);
+
+  batch[0] = (struct syscall_entry){SYS_PRACTICE, {1}, 0};
+  batch[1] = (struct syscall_entry){SYS_FILESIZE, {1234}, 0};
+  batch[2] = (struct syscall_entry){SYS_PRACTICE, {2}, 0};
+  CHECK(syscall_batch(batch, 3, BATCH_STOP_ON_ERROR) == 2, "batch stops at failing call");
+  CHECK(batch[0].result == 2 && batch[1].result == -1 && batch[2].result == 0,
+        "results written back in place");
+
+  msg("bench: %d-byte copy in %d-byte pieces: %llu cycles with traps, %llu batched", SIZE, CHUNK,
+      traps, batched);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(sc-batch) begin
+(sc-batch) create "source"
+(sc-batch) open "source"
+(sc-batch) write "source"
+(sc-batch) create "copy-traps"
+(sc-batch) open "source"
+(sc-batch) open "copy-traps"
+(sc-batch) "copy-traps" matches "source"
+(sc-batch) create "copy-batch"
+(sc-batch) open "source"
+(sc-batch) open "copy-batch"
+(sc-batch) "copy-batch" matches "source"
+(sc-batch) batch stops at failing call
+(sc-batch) results written back in place
+(sc-batch) end
+EOF
+pass;
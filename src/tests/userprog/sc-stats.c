@@ -0,0 +1,31 @@
+/* Makes a known number of practice() calls and checks that the
+   kernel's per-system-call counters saw every one of them, then
+   reports the round-trip cost of a practice() call as seen from
+   user space and the time the kernel spent in its handler. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALLS 1000
+
+void test_main(void) {
+  struct sysstat before, after;
+  uint64_t start, cycles;
+  int i;
+
+  CHECK(sysstat(SYS_PRACTICE, &before), "sysstat(SYS_PRACTICE)");
+  start = rdtsc();
+  for (i = 0; i < CALLS; i++)
+    if (practice(i) != i + 1)
+      fail("practice(%d) returned the wrong value", i);
+  cycles = rdtsc() - start;
+  CHECK(sysstat(SYS_PRACTICE, &after), "sysstat(SYS_PRACTICE) again");
+  CHECK(after.calls - before.calls == CALLS, "counted %d calls", CALLS);
+  CHECK(!sysstat(-1, &after), "sysstat(-1) fails");
+
+  msg("bench: practice() %llu cycles/call round trip, %llu in handler", cycles / CALLS,
+      (after.cycles - before.cycles) / CALLS);
+}
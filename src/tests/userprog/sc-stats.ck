@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(sc-stats) begin
+(sc-stats) sysstat(SYS_PRACTICE)
+(sc-stats) sysstat(SYS_PRACTICE) again
+(sc-stats) counted 1000 calls
+(sc-stats) sysstat(-1) fails
+(sc-stats) end
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Times a null system call, practice(), entering the kernel
+   through int $0x30 and through SYSENTER.  Falls back to timing
+   int $0x30 twice if the CPU lacks SYSENTER. */
+
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALLS 1000
+
+/* Makes CALLS practice() calls and returns the cycles per call. */
+static uint64_t time_practice(void) {
+  uint64_t start = rdtsc();
+  int i;
+
+  for (i = 0; i < CALLS; i++)
+    if (practice(i) != i + 1)
+      fail("practice(%d) returned the wrong value", i);
+  return (rdtsc() - start) / CALLS;
+}
+
+void test_main(void) {
+  bool sysenter = syscall_sysenter;
+  uint64_t slow, fast;
+
+  syscall_sysenter = false;
+  slow = time_practice();
+  msg("practice() through int $0x30");
+
+  syscall_sysenter = sysenter;
+  fast = time_practice();
+  msg("practice() through the fast path");
+
+  msg("bench: int $0x30 %llu cycles/call, %s %llu cycles/call", slow,
+      sysenter ? "sysenter" : "int $0x30 (no sysenter)", fast);
+}
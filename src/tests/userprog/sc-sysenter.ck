@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(sc-sysenter) begin
+(sc-sysenter) practice() through int $0x30
+(sc-sysenter) practice() through the fast path
+(sc-sysenter) end
+EOF
+pass;
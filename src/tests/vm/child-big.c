@@ -0,0 +1,22 @@
+/* Child process of exec-lazy.
+   Has a large data segment and a large BSS but touches only a
+   few pages of them, so that most of the image is never brought
+   in. */
+
+#include "tests/lib.h"
+
+#define DATA_SIZE (128 * 1024)
+#define BSS_SIZE (1024 * 1024)
+
+static char data[DATA_SIZE] = {0x42};
+static char bss[BSS_SIZE];
+
+int main(void) {
+  test_name = "child-big";
+
+  if (data[0] != 0x42 || data[DATA_SIZE - 1] != 0)
+    fail("data segment corrupted");
+  if (bss[BSS_SIZE / 2] != 0)
+    fail("bss not zeroed");
+  return data[0];
+}
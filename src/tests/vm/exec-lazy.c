@@ -0,0 +1,32 @@
+/* Executes child-big, which has 128 kB of initialized data and
+   1 MB of uninitialized data but touches only a few pages of
+   either, several times and reports how long exec() takes.
+   With demand paging exec() only has to read the ELF headers,
+   so its latency should not depend on the size of the image. */
+
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 4
+
+void test_main(void) {
+  uint64_t cycles = 0;
+  int i;
+
+  for (i = 0; i < ROUNDS; i++) {
+    uint64_t start;
+    pid_t child;
+
+    start = rdtsc();
+    child = exec("child-big");
+    cycles += rdtsc() - start;
+    if (child == -1)
+      fail("exec \"child-big\" failed");
+    if (wait(child) != 0x42)
+      fail("child-big exited with wrong status");
+  }
+  msg("ran child-big %d times", ROUNDS);
+  msg("bench: exec latency %llu cycles", cycles / ROUNDS);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(exec-lazy) begin
+(exec-lazy) ran child-big 4 times
+(exec-lazy) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Forks a process with a large, fully resident address space.
+   Checks that parent and child end up with separate copies of
+   the pages the child writes and that the child inherits the
+   position of an open file, then reports the cost of fork()
+   followed by the child's exit(). */
+
+#include <string.h>
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (512 * 1024)
+#define ROUNDS 8
+
+static char buf[SIZE];
+
+void test_main(void) {
+  uint64_t cycles = 0;
+  int handle, i;
+  pid_t pid;
+  char c;
+
+  memset(buf, 'p', SIZE);
+  CHECK((handle = open("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK(read(handle, &c, 1) == 1 && c == sample[0], "read first byte");
+
+  pid = fork();
+  if (pid == 0) {
+    /* Child: continue reading where the parent left off and
+       scribble on the shared pages. */
+    if (read(handle, &c, 1) != 1 || c != sample[1])
+      fail("child read wrong byte");
+    buf[0] = buf[SIZE - 1] = 'c';
+    exit(0x42);
+  }
+  CHECK(pid > 0, "fork");
+  CHECK(wait(pid) == 0x42, "wait for child");
+  CHECK(buf[0] == 'p' && buf[SIZE - 1] == 'p', "parent's pages unchanged");
+
+  for (i = 0; i < ROUNDS; i++) {
+    uint64_t start = rdtsc();
+
+    pid = fork();
+    if (pid == 0)
+      exit(0);
+    wait(pid);
+    cycles += rdtsc() - start;
+  }
+  msg("bench: fork+exit %llu cycles with %d kB resident", cycles / ROUNDS, SIZE / 1024);
+}
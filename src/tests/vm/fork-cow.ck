@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(fork-cow) begin
+(fork-cow) open "sample.txt"
+(fork-cow) read first byte
+(fork-cow) fork
+(fork-cow) wait for child
+(fork-cow) parent's pages unchanged
+(fork-cow) end
+EOF
+pass;
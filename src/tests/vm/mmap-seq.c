@@ -0,0 +1,48 @@
+/* Creates a 256 kB file, maps it and reads it front to back,
+   checking every byte.  Reports how many cycles the first pass
+   over the mapping takes per page, which is dominated by page
+   faults and the disk reads behind them. */
+
+#include <string.h>
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (256 * 1024)
+#define PAGE 4096
+#define ACTUAL ((const char*)0x10000000)
+
+static char buf[PAGE];
+
+void test_main(void) {
+  uint64_t start, cycles;
+  size_t ofs, errors = 0;
+  int handle;
+  mapid_t map;
+
+  CHECK(create("seq.bin", SIZE), "create \"seq.bin\"");
+  CHECK((handle = open("seq.bin")) > 1, "open \"seq.bin\"");
+  for (ofs = 0; ofs < SIZE; ofs += PAGE) {
+    size_t i;
+
+    for (i = 0; i < PAGE; i++)
+      buf[i] = (ofs + i) * 7 % 251;
+    if (write(handle, buf, PAGE) != PAGE)
+      fail("write \"seq.bin\" failed");
+  }
+
+  CHECK((map = mmap(handle, (void*)ACTUAL)) != MAP_FAILED, "mmap \"seq.bin\"");
+  start = rdtsc();
+  for (ofs = 0; ofs < SIZE; ofs++)
+    if (ACTUAL[ofs] != (char)(ofs * 7 % 251))
+      errors++;
+  cycles = rdtsc() - start;
+  if (errors != 0)
+    fail("%zu bytes differ from what was written", errors);
+  msg("read %d kB through the mapping", SIZE / 1024);
+  msg("bench: sequential mmap read %llu cycles/page", cycles / (SIZE / PAGE));
+
+  munmap(map);
+  close(handle);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(mmap-seq) begin
+(mmap-seq) create "seq.bin"
+(mmap-seq) open "seq.bin"
+(mmap-seq) mmap "seq.bin"
+(mmap-seq) read 256 kB through the mapping
+(mmap-seq) end
+EOF
+pass;
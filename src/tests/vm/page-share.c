@@ -0,0 +1,47 @@
+/* Touches every page of a large read-only table, then runs a
+   second copy of itself that does the same while the first copy
+   is still alive.  Read-only pages of an executable are shared
+   between processes, so the second copy should map the pages
+   that the first one already read in instead of going to disk. */
+
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+
+#define SIZE (256 * 1024)
+
+static const char table[SIZE] = {1};
+
+/* Reads one byte from every page of TABLE and returns the
+   number of cycles that took. */
+static uint64_t touch_table(void) {
+  uint64_t start = rdtsc();
+  int sum = 0;
+  size_t i;
+
+  for (i = 0; i < SIZE; i += 4096)
+    sum += table[i];
+  if (sum != 1)
+    fail("table contents wrong");
+  return rdtsc() - start;
+}
+
+int main(int argc, char* argv[] UNUSED) {
+  uint64_t cycles;
+
+  test_name = "page-share";
+
+  if (argc > 1) {
+    /* Second copy. */
+    cycles = touch_table();
+    msg("bench: second instance %llu cycles", cycles);
+    return 0;
+  }
+
+  msg("begin");
+  cycles = touch_table();
+  msg("bench: first instance %llu cycles", cycles);
+  CHECK(wait(exec("page-share child")) == 0, "run second instance");
+  msg("end");
+  return 0;
+}
@@ -0,0 +1,112 @@
+/* Pushes 1 MB through a chain of processes connected by pipes:
+   a producer, two stages that copy their input to their output,
+   and the parent as the consumer, which checks every byte.  Runs
+   the chain once with page-aligned buffers, where whole pages
+   move by remapping, and once with buffers one byte off, where
+   every stage copies, and reports the cost per kilobyte of
+   each. */
+
+#include <string.h>
+#include <syscall.h>
+#include <tsc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PAGES 256
+#define STAGES 4
+
+static char buf[2 * PAGE] __attribute__((aligned(PAGE)));
+
+/* Closes every descriptor in PIPES except KEEP_IN and KEEP_OUT. */
+static void close_others(int pipes[][2], int keep_in, int keep_out) {
+  int i, j;
+
+  for (i = 0; i < STAGES - 1; i++)
+    for (j = 0; j < 2; j++)
+      if (pipes[i][j] != keep_in && pipes[i][j] != keep_out)
+        close(pipes[i][j]);
+}
+
+/* Stage 0: writes PAGES pages, page I filled with I. */
+static void produce(int out, char* data) {
+  int i;
+
+  for (i = 0; i < PAGES; i++) {
+    memset(data, i, PAGE);
+    if (write(out, data, PAGE) != PAGE)
+      fail("producer write failed");
+  }
+}
+
+/* Middle stages: copy IN to OUT until end of file. */
+static void relay(int in, int out, char* data) {
+  int n;
+
+  while ((n = read(in, data, PAGE)) > 0)
+    if (write(out, data, n) != n)
+      fail("relay write failed");
+}
+
+/* Runs the chain with buffers at DATA and returns the cycles it
+   took from the first fork() to the last byte read. */
+static uint64_t run_chain(char* data, const char* name) {
+  int pipes[STAGES - 1][2];
+  pid_t pids[STAGES - 1];
+  uint64_t start, cycles;
+  int i, total = 0;
+
+  for (i = 0; i < STAGES - 1; i++)
+    if (pipe(pipes[i]) != 0)
+      fail("pipe failed");
+
+  start = rdtsc();
+  for (i = 0; i < STAGES - 1; i++) {
+    pids[i] = fork();
+    if (pids[i] == 0) {
+      int in = i > 0 ? pipes[i - 1][0] : -1;
+      int out = pipes[i][1];
+
+      close_others(pipes, in, out);
+      if (i == 0)
+        produce(out, data);
+      else
+        relay(in, out, data);
+      exit(0);
+    }
+    if (pids[i] < 0)
+      fail("fork failed");
+  }
+  close_others(pipes, pipes[STAGES - 2][0], -1);
+
+  /* Consumer. */
+  for (;;) {
+    int n = read(pipes[STAGES - 2][0], data, PAGE), j;
+
+    if (n <= 0)
+      break;
+    for (j = 0; j < n; j++)
+      if (data[j] != (char)((total + j) / PAGE))
+        fail("byte %d is wrong", total + j);
+    total += n;
+  }
+  cycles = rdtsc() - start;
+  close(pipes[STAGES - 2][0]);
+
+  for (i = 0; i < STAGES - 1; i++)
+    if (wait(pids[i]) != 0)
+      fail("stage %d failed", i);
+  if (total != PAGES * PAGE)
+    fail("read %d bytes instead of %d", total, PAGES * PAGE);
+  msg("%s chain delivered %d bytes", name, total);
+  return cycles;
+}
+
+void test_main(void) {
+  uint64_t aligned, unaligned;
+
+  aligned = run_chain(buf, "aligned");
+  unaligned = run_chain(buf + 1, "unaligned");
+  msg("bench: %d-process pipe chain, %d KB: %llu cycles/KB page-aligned, %llu unaligned", STAGES,
+      PAGES * PAGE / 1024, aligned / (PAGES * PAGE / 1024), unaligned / (PAGES * PAGE / 1024));
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_BENCHMARKS => 1, [<<'EOF']);
+(pipe-chain) begin
+(pipe-chain) aligned chain delivered 1048576 bytes
+(pipe-chain) unaligned chain delivered 1048576 bytes
+(pipe-chain) end
+EOF
+pass;
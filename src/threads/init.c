@@ -1,5 +1,6 @@
 #include "threads/init.h"
 #include <console.h>
+#include <cpuid.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -21,7 +22,9 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/parallel.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -40,10 +43,24 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t* init_page_dir;
 
+/* CR4中与分页有关的位 */
+#define CR4_PSE 0x10 /* 启用4 MB页 */
+#define CR4_PGE 0x80 /* 启用全局页 */
+
+/* 内核映射用的4 MB页数和页表数，见paging_init() */
+static size_t large_page_cnt;
+static size_t page_table_cnt;
+static bool global_pages;
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -95,6 +112,7 @@ int main(void) {
   /* Initialize memory system. */
   palloc_init(user_page_limit);
   malloc_init();
+  slab_init();
   paging_init();
 
   /* Segmentation. */
@@ -117,6 +135,7 @@ int main(void) {
   thread_start();
   serial_init_queue();
   timer_calibrate();
+  parallel_init();
 
 #ifdef USERPROG
   /* Give main thread a minimal PCB so it can launch the first process */
@@ -131,6 +150,12 @@ int main(void) {
   filesys_init(format_filesys);
 #endif
 
+#ifdef VM
+  frame_init();
+  swap_init();
+  page_init();
+#endif
+
   printf("Boot complete.\n");
 
   /* Run actions specified on kernel command line. */
@@ -155,11 +180,25 @@ static void bss_init(void) {
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   CPU支持的话，整块落在内存里的4 MB直接用一个4 MB页映射，
+   省下页表，也少占TLB项。内核映像所在的第一个4 MB还用4 KB
+   页，这样代码段仍然是只读的；不够4 MB的尾巴和不支持4 MB页
+   的CPU也用4 KB页。所有内核映射都设成全局的，切换页目录
+   重新加载CR3时不会被冲掉。 */
 static void paging_init(void) {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = cpuid_features(NULL);
+  bool pse = (features & CPUID_PSE) != 0;
+  uint32_t global = 0;
+  uint32_t cr4;
+
+  global_pages = (features & CPUID_PGE) != 0;
+  if (global_pages)
+    global = PTE_G;
 
   pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,19 +210,46 @@ static void paging_init(void) {
     bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
     if (pd[pde_idx] == 0) {
+      /* 和内核代码段重叠的4 MB要按页设置只读，不能用4 MB页 */
+      bool has_text = vaddr < &_end_kernel_text && &_start < vaddr + LARGE_PGSIZE;
+
+      if (pse && pte_idx == 0 && !has_text && page + LARGE_PGSIZE / PGSIZE <= init_ram_pages) {
+        pd[pde_idx] = pde_create_large(vaddr) | global;
+        large_page_cnt++;
+        page += LARGE_PGSIZE / PGSIZE - 1;
+        continue;
+      }
       pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
       pd[pde_idx] = pde_create(pt);
+      page_table_cnt++;
     }
 
-    pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text);
+    pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text) | global;
   }
 
+  /* 先打开CR4.PSE，再加载用到4 MB页的页目录 */
+  asm volatile("movl %%cr4, %0" : "=r"(cr4));
+  if (pse)
+    cr4 |= CR4_PSE;
+  asm volatile("movl %0, %%cr4" : : "r"(cr4));
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile("movl %0, %%cr3" : : "r"(vtop(init_page_dir)));
+
+  if (global_pages) {
+    cr4 |= CR4_PGE;
+    asm volatile("movl %0, %%cr4" : : "r"(cr4));
+  }
+}
+
+/* 打印内核映射的统计信息 */
+void paging_print_stats(void) {
+  printf("Kernel map: %zu 4 MB pages, %zu page tables, global pages %s\n", large_page_cnt,
+         page_table_cnt, global_pages ? "on" : "off");
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -11,11 +11,11 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  The descriptor keeps a list of
+   free blocks.  If the free list is nonempty, one of its blocks
+   is used to satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
    obtained from the page allocator (if none is available,
@@ -28,6 +28,11 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
+   Size classes are spaced more finely than powers of 2, and each
+   class is stretched to the largest multiple of 8 bytes that
+   still fits the same number of blocks in an arena, so that
+   little of each page is wasted.
+
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
@@ -40,6 +45,12 @@ struct desc {
   size_t blocks_per_arena; /* Number of blocks in an arena. */
   struct list free_list;   /* List of free blocks. */
   struct lock lock;        /* Lock. */
+
+  /* 统计 */
+  size_t in_use;           /* 正在使用的块数 */
+  size_t arena_cnt;        /* 现有的arena数 */
+  long long alloc_cnt;     /* 分配次数 */
+  long long req_bytes;     /* 请求的总字节数 */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -57,25 +68,44 @@ struct block {
   struct list_elem free_elem; /* Free list element. */
 };
 
+/* 期望的大小类，malloc_init()会把每一类放大到同样块数下
+   一个arena能容纳的最大值 */
+static const size_t class_sizes[] = {16,  24,  32,  48,  64,  96,   128,
+                                     192, 256, 384, 512, 768, 1024, 1536};
+
 /* Our set of descriptors. */
-static struct desc descs[10]; /* Descriptors. */
-static size_t desc_cnt;       /* Number of descriptors. */
+#define DESC_CNT (sizeof class_sizes / sizeof *class_sizes)
+static struct desc descs[DESC_CNT]; /* Descriptors. */
+static size_t desc_cnt;             /* Number of descriptors. */
+
+/* 大块的统计 */
+static struct lock big_lock;
+static size_t big_pages;       /* 正在使用的页数 */
+static long long big_cnt;      /* 分配次数 */
+static long long big_req;      /* 请求的总字节数 */
+static long long big_reserved; /* 占用的总字节数 */
 
 static struct arena* block_to_arena(struct block*);
 static struct block* arena_to_block(struct arena*, size_t idx);
 
 /* Initializes the malloc() descriptors. */
 void malloc_init(void) {
-  size_t block_size;
+  size_t i;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+  for (i = 0; i < DESC_CNT; i++) {
     struct desc* d = &descs[desc_cnt++];
-    ASSERT(desc_cnt <= sizeof descs / sizeof *descs);
-    d->block_size = block_size;
-    d->blocks_per_arena = (PGSIZE - sizeof(struct arena)) / block_size;
+    size_t blocks = (PGSIZE - sizeof(struct arena)) / class_sizes[i];
+
+    d->blocks_per_arena = blocks;
+    d->block_size = ROUND_DOWN((PGSIZE - sizeof(struct arena)) / blocks, 8);
+    ASSERT(d->block_size >= class_sizes[i]);
+    ASSERT(i == 0 || d->block_size > descs[i - 1].block_size);
     list_init(&d->free_list);
     lock_init(&d->lock);
+    d->in_use = d->arena_cnt = 0;
+    d->alloc_cnt = d->req_bytes = 0;
   }
+  lock_init(&big_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -107,6 +137,13 @@ void* malloc(size_t size) {
     a->magic = ARENA_MAGIC;
     a->desc = NULL;
     a->free_cnt = page_cnt;
+
+    lock_acquire(&big_lock);
+    big_pages += page_cnt;
+    big_cnt++;
+    big_req += size;
+    big_reserved += page_cnt * PGSIZE;
+    lock_release(&big_lock);
     return a + 1;
   }
 
@@ -127,6 +164,7 @@ void* malloc(size_t size) {
     a->magic = ARENA_MAGIC;
     a->desc = d;
     a->free_cnt = d->blocks_per_arena;
+    d->arena_cnt++;
     for (i = 0; i < d->blocks_per_arena; i++) {
       struct block* b = arena_to_block(a, i);
       list_push_back(&d->free_list, &b->free_elem);
@@ -137,6 +175,9 @@ void* malloc(size_t size) {
   b = list_entry(list_pop_front(&d->free_list), struct block, free_elem);
   a = block_to_arena(b);
   a->free_cnt--;
+  d->in_use++;
+  d->alloc_cnt++;
+  d->req_bytes += size;
   lock_release(&d->lock);
   return b;
 }
@@ -211,6 +252,7 @@ void free(void* p) {
 
       /* Add block to free list. */
       list_push_front(&d->free_list, &b->free_elem);
+      d->in_use--;
 
       /* If the arena is now entirely unused, free it. */
       if (++a->free_cnt >= d->blocks_per_arena) {
@@ -222,17 +264,40 @@ void free(void* p) {
           list_remove(&b->free_elem);
         }
         palloc_free_page(a);
+        d->arena_cnt--;
       }
 
       lock_release(&d->lock);
     } else {
       /* It's a big block.  Free its pages. */
+      lock_acquire(&big_lock);
+      big_pages -= a->free_cnt;
+      lock_release(&big_lock);
       palloc_free_multiple(a, a->free_cnt);
       return;
     }
   }
 }
 
+/* 打印每个大小类请求的字节数和实际占用的字节数 */
+void malloc_stats(void) {
+  struct desc* d;
+
+  printf("malloc: class  arenas  in use   allocs   requested    reserved  waste\n");
+  for (d = descs; d < descs + desc_cnt; d++) {
+    long long reserved = d->alloc_cnt * (long long)d->block_size;
+
+    if (d->alloc_cnt == 0)
+      continue;
+    printf("malloc: %5zu %7zu %7zu %8lld %11lld %11lld %5lld%%\n", d->block_size, d->arena_cnt,
+           d->in_use, d->alloc_cnt, d->req_bytes, reserved,
+           (reserved - d->req_bytes) * 100 / reserved);
+  }
+  if (big_cnt > 0)
+    printf("malloc: big   %7zu %7s %8lld %11lld %11lld %5lld%%\n", big_pages, "-", big_cnt,
+           big_req, big_reserved, (big_reserved - big_req) * 100 / big_reserved);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena* block_to_arena(struct block* b) {
   struct arena* a = pg_round_down(b);
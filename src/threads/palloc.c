@@ -1,5 +1,5 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
+#include <list.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,13 +24,62 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within each pool, pages are managed by a binary buddy
+   allocator. */
+
+/* 伙伴系统：空闲页按2的幂大小、按自身大小对齐（相对池的
+   起点）的块来管理，每个阶一条空闲链表。分配时从最小的够用
+   的阶取块，多余的部分一半一半地拆回低阶链表；释放时只要伙伴
+   块也空闲且同阶，就不断合并成更高阶的块。两者都是O(log n)。
+
+   不是2的幂的请求按块分配后，把尾部多出来的页立即还回去，
+   所以调用者仍然可以像以前一样按页数释放，甚至只释放一部分。
+
+   每页在池的头部有一个字节的元数据：只有空闲块的首页会标记
+   PAGE_FREE和块的阶，空闲链表的list_elem就放在空闲块的首页里。
+
+   预先清零：没别的线程可跑时，空闲线程调用palloc_idle_zero()
+   从伙伴系统里取出单页，清零后放进池的zeroed链表，攒到
+   zeroed_target页为止。单页的PAL_ZERO请求先从这里拿，不用
+   当场清零。zeroed里的页对伙伴系统来说是已分配的，伙伴系统
+   分配失败时先把它们全部还回去再试一次。 */
+
+/* 阶的个数，最大的块是2^(PALLOC_ORDERS-1)页 */
+#define PALLOC_ORDERS 12
+
+/* 每个池最多预先清零的页数 */
+#define PALLOC_ZEROED_MAX 64
+
+#define PAGE_FREE 0x80       /* 空闲块的首页 */
+#define PAGE_ORDER_MASK 0x7f /* 空闲块的阶 */
+
+/* 每个阶的统计 */
+struct order_stats {
+  size_t free_cnt;     /* 当前空闲块数 */
+  long long alloc_cnt; /* 在这个阶上分配的次数 */
+  long long split_cnt; /* 这个阶的块被拆开的次数 */
+  long long merge_cnt; /* 合并成这个阶的块的次数 */
+};
 
 /* A memory pool. */
 struct pool {
-  struct lock lock;        /* Mutual exclusion. */
-  struct bitmap* used_map; /* Bitmap of free pages. */
-  uint8_t* base;           /* Base of pool. */
+  struct lock lock;                        /* Mutual exclusion. */
+  uint8_t* page_info;                      /* 每页一个字节的元数据 */
+  size_t page_cnt;                         /* 池里的页数 */
+  size_t free_pages;                       /* 空闲页数 */
+  long long fail_cnt;                      /* 分配失败的次数 */
+  struct list free_lists[PALLOC_ORDERS];   /* 每个阶的空闲块 */
+  struct order_stats stats[PALLOC_ORDERS]; /* 每个阶的统计 */
+  uint8_t* base;                           /* Base of pool. */
+
+  struct list zeroed;      /* 预先清零的单页 */
+  size_t zeroed_cnt;       /* zeroed中的页数 */
+  size_t zeroed_target;    /* 空闲线程要攒够的页数 */
+  uint8_t* zeroing;        /* 空闲线程正在清零、还没放进zeroed的页 */
+  long long zero_hit_cnt;  /* 用了预先清零的页的PAL_ZERO请求数 */
+  long long zero_miss_cnt; /* 只能当场清零的PAL_ZERO请求数 */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -37,6 +87,13 @@ static struct pool kernel_pool, user_pool;
 
 static void init_pool(struct pool*, void* base, size_t page_cnt, const char* name);
 static bool page_from_pool(const struct pool*, void* page);
+static size_t alloc_block(struct pool*, size_t page_cnt);
+static void free_range(struct pool*, size_t page_idx, size_t page_cnt);
+static void free_block(struct pool*, size_t page_idx, unsigned order);
+static void print_pool_stats(const struct pool*, const char* name);
+static void* take_zeroed(struct pool*);
+static void release_zeroed(struct pool*);
+static bool zero_one(struct pool*);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -64,21 +121,33 @@ void palloc_init(size_t user_page_limit) {
    FLAGS, in which case the kernel panics. */
 void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
   struct pool* pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void* pages;
+  void* pages = NULL;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
   lock_acquire(&pool->lock);
-  page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
+  if ((flags & PAL_ZERO) && page_cnt == 1)
+    pages = take_zeroed(pool);
+  if (pages == NULL) {
+    page_idx = alloc_block(pool, page_cnt);
+    if (page_idx == SIZE_MAX && pool->zeroed_cnt > 0) {
+      release_zeroed(pool);
+      page_idx = alloc_block(pool, page_cnt);
+    }
+    if (page_idx != SIZE_MAX) {
+      pages = pool->base + PGSIZE * page_idx;
+      if (flags & PAL_ZERO)
+        pool->zero_miss_cnt++;
+    } else {
+      flags &= ~PAL_ZERO;
+      pool->fail_cnt++;
+    }
+  } else
+    flags &= ~PAL_ZERO;
   lock_release(&pool->lock);
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
-
   if (pages != NULL) {
     if (flags & PAL_ZERO)
       memset(pages, 0, PGSIZE * page_cnt);
@@ -121,30 +190,63 @@ void palloc_free_multiple(void* pages, size_t page_cnt) {
   memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+  ASSERT(page_idx + page_cnt <= pool->page_cnt);
+  lock_acquire(&pool->lock);
+  free_range(pool, page_idx, page_cnt);
+  lock_release(&pool->lock);
 }
 
 /* Frees the page at PAGE. */
 void palloc_free_page(void* page) { palloc_free_multiple(page, 1); }
 
+/* 打印两个池每个阶的空闲块数和分配、拆分、合并次数 */
+void palloc_print_stats(void) {
+  print_pool_stats(&kernel_pool, "Kernel pool");
+  print_pool_stats(&user_pool, "User pool");
+}
+
+/* 给预先清零的页不够的池清零一页。只由空闲线程调用，不会
+   睡眠；清零时开着中断，随时可以被抢占。还有页要清零时
+   返回true */
+bool palloc_idle_zero(void) {
+  bool more = zero_one(&kernel_pool);
+  return zero_one(&user_pool) || more;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void init_pool(struct pool* p, void* base, size_t page_cnt, const char* name) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's page_info at its base.
+     Calculate the space needed for it
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t info_pages = DIV_ROUND_UP(page_cnt, PGSIZE);
+  size_t i;
+
+  if (info_pages > page_cnt)
+    PANIC("Not enough memory in %s for page info.", name);
+  page_cnt -= info_pages;
 
   printf("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
   lock_init(&p->lock);
-  p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->page_info = base;
+  p->page_cnt = page_cnt;
+  p->free_pages = 0;
+  p->fail_cnt = 0;
+  for (i = 0; i < PALLOC_ORDERS; i++)
+    list_init(&p->free_lists[i]);
+  memset(p->stats, 0, sizeof p->stats);
+  memset(p->page_info, 0, page_cnt);
+  p->base = base + info_pages * PGSIZE;
+  list_init(&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->zeroed_target = page_cnt / 32 < PALLOC_ZEROED_MAX ? page_cnt / 32 : PALLOC_ZEROED_MAX;
+  p->zeroing = NULL;
+  p->zero_hit_cnt = p->zero_miss_cnt = 0;
+
+  /* 把整个池按尽量大的对齐块放进空闲链表 */
+  free_range(p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -152,7 +254,192 @@ static void init_pool(struct pool* p, void* base, size_t page_cnt, const char* n
 static bool page_from_pool(const struct pool* pool, void* page) {
   size_t page_no = pg_no(page);
   size_t start_page = pg_no(pool->base);
-  size_t end_page = start_page + bitmap_size(pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* 返回POOL里第PAGE_IDX页的地址 */
+static inline struct list_elem* block_elem(const struct pool* pool, size_t page_idx) {
+  return (struct list_elem*)(pool->base + PGSIZE * page_idx);
+}
+
+/* 返回能容纳PAGE_CNT页的最小的阶 */
+static unsigned order_for(size_t page_cnt) {
+  unsigned order = 0;
+
+  while (((size_t)1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* 把从PAGE_IDX开始的ORDER阶空闲块放入空闲链表，不合并 */
+static void push_block(struct pool* pool, size_t page_idx, unsigned order) {
+  pool->page_info[page_idx] = PAGE_FREE | order;
+  list_push_front(&pool->free_lists[order], block_elem(pool, page_idx));
+  pool->stats[order].free_cnt++;
+  pool->free_pages += (size_t)1 << order;
+}
+
+/* 把从PAGE_IDX开始的ORDER阶空闲块从空闲链表中取出 */
+static void pop_block(struct pool* pool, size_t page_idx, unsigned order) {
+  ASSERT(pool->page_info[page_idx] == (PAGE_FREE | order));
+  pool->page_info[page_idx] = 0;
+  list_remove(block_elem(pool, page_idx));
+  pool->stats[order].free_cnt--;
+  pool->free_pages -= (size_t)1 << order;
+}
+
+/* 从POOL中分配PAGE_CNT个连续的页，返回第一页的下标，
+   失败返回SIZE_MAX。调用者持有POOL的锁 */
+static size_t alloc_block(struct pool* pool, size_t page_cnt) {
+  unsigned want = order_for(page_cnt);
+  unsigned order;
+  size_t page_idx;
+
+  /* 找到最小的非空阶 */
+  for (order = want; order < PALLOC_ORDERS; order++)
+    if (!list_empty(&pool->free_lists[order]))
+      break;
+  if (order >= PALLOC_ORDERS)
+    return SIZE_MAX;
+
+  page_idx = ((uint8_t*)list_front(&pool->free_lists[order]) - pool->base) / PGSIZE;
+  pop_block(pool, page_idx, order);
+
+  /* 拆开，后一半放回低一阶的链表 */
+  while (order > want) {
+    pool->stats[order].split_cnt++;
+    order--;
+    push_block(pool, page_idx + ((size_t)1 << order), order);
+  }
+  pool->stats[want].alloc_cnt++;
+
+  /* 还回不需要的尾部 */
+  if (page_cnt < (size_t)1 << want)
+    free_range(pool, page_idx + page_cnt, ((size_t)1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* 释放从PAGE_IDX开始的PAGE_CNT页：拆成尽量大的对齐块
+   逐个释放。调用者持有POOL的锁 */
+static void free_range(struct pool* pool, size_t page_idx, size_t page_cnt) {
+  while (page_cnt > 0) {
+    unsigned order = 0;
+
+    while (order + 1 < PALLOC_ORDERS && page_idx % ((size_t)2 << order) == 0 &&
+           ((size_t)2 << order) <= page_cnt)
+      order++;
+    free_block(pool, page_idx, order);
+    page_idx += (size_t)1 << order;
+    page_cnt -= (size_t)1 << order;
+  }
+}
+
+/* 释放从PAGE_IDX开始的ORDER阶块，并和空闲的伙伴合并。
+   调用者持有POOL的锁 */
+static void free_block(struct pool* pool, size_t page_idx, unsigned order) {
+  ASSERT(page_idx % ((size_t)1 << order) == 0);
+  ASSERT(!(pool->page_info[page_idx] & PAGE_FREE));
+
+  while (order + 1 < PALLOC_ORDERS) {
+    size_t buddy = page_idx ^ ((size_t)1 << order);
+
+    if (buddy + ((size_t)1 << order) > pool->page_cnt ||
+        pool->page_info[buddy] != (PAGE_FREE | order))
+      break;
+    pop_block(pool, buddy, order);
+    if (buddy < page_idx)
+      page_idx = buddy;
+    order++;
+    pool->stats[order].merge_cnt++;
+  }
+  push_block(pool, page_idx, order);
+}
+
+/* 从POOL的zeroed链表取一页，没有时返回空指针。调用者持有
+   POOL的锁 */
+static void* take_zeroed(struct pool* pool) {
+  struct list_elem* e;
+
+  if (list_empty(&pool->zeroed))
+    return NULL;
+  e = list_pop_front(&pool->zeroed);
+  pool->zeroed_cnt--;
+  pool->zero_hit_cnt++;
+
+  /* 链表元素就放在页里，要重新清掉 */
+  memset(e, 0, sizeof *e);
+  return e;
+}
+
+/* 把POOL的zeroed链表里的页都还给伙伴系统。调用者持有POOL的锁 */
+static void release_zeroed(struct pool* pool) {
+  while (!list_empty(&pool->zeroed)) {
+    uint8_t* page = (uint8_t*)list_pop_front(&pool->zeroed);
+    free_range(pool, (page - pool->base) / PGSIZE, 1);
+  }
+  pool->zeroed_cnt = 0;
+}
+
+/* 给POOL清零一页放进zeroed链表，还没攒够时返回true。
+   只在关中断时短暂地拿POOL的锁，空闲线程持有锁时不会被
+   抢占；拿不到锁就下次再试 */
+static bool zero_one(struct pool* pool) {
+  enum intr_level old_level;
+  bool more;
+
+  if (pool->zeroing == NULL) {
+    if (pool->zeroed_cnt >= pool->zeroed_target)
+      return false;
+    old_level = intr_disable();
+    if (pool->free_pages > 0 && lock_try_acquire(&pool->lock)) {
+      size_t page_idx = alloc_block(pool, 1);
+      if (page_idx != SIZE_MAX)
+        pool->zeroing = pool->base + PGSIZE * page_idx;
+      lock_release(&pool->lock);
+    }
+    intr_set_level(old_level);
+    if (pool->zeroing == NULL)
+      return false;
+    memset(pool->zeroing, 0, PGSIZE);
+  }
+
+  old_level = intr_disable();
+  if (lock_try_acquire(&pool->lock)) {
+    list_push_back(&pool->zeroed, (struct list_elem*)pool->zeroing);
+    pool->zeroed_cnt++;
+    pool->zeroing = NULL;
+    lock_release(&pool->lock);
+  }
+  more = pool->zeroed_cnt < pool->zeroed_target;
+  intr_set_level(old_level);
+  return more;
+}
+
+/* 打印POOL的统计信息 */
+static void print_pool_stats(const struct pool* pool, const char* name) {
+  size_t largest = 0;
+  unsigned order;
+
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    if (pool->stats[order].free_cnt > 0)
+      largest = (size_t)1 << order;
+
+  /* 外部碎片：空闲页中不在最大空闲块里的比例 */
+  printf("%s: %zu of %zu pages free, largest free block %zu pages, "
+         "%zu%% fragmented, %lld failed requests\n",
+         name, pool->free_pages, pool->page_cnt, largest,
+         pool->free_pages ? 100 - largest * 100 / pool->free_pages : 0, pool->fail_cnt);
+  printf("  pre-zeroed: %zu of %zu pages ready, %lld PAL_ZERO requests served, "
+         "%lld zeroed on demand\n",
+         pool->zeroed_cnt, pool->zeroed_target, pool->zero_hit_cnt, pool->zero_miss_cnt);
+  for (order = 0; order < PALLOC_ORDERS; order++) {
+    const struct order_stats* st = &pool->stats[order];
+
+    if (st->free_cnt == 0 && st->alloc_cnt == 0 && st->split_cnt == 0 && st->merge_cnt == 0)
+      continue;
+    printf("  order %2u: %zu free, %lld allocs, %lld splits, %lld merges\n", order, st->free_cnt,
+           st->alloc_cnt, st->split_cnt, st->merge_cnt);
+  }
+}
@@ -0,0 +1,200 @@
+#include "threads/parallel.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* 内核里的fork/join。
+
+   第一次并行执行时创建PARALLEL_WORKERS个常驻工作线程，
+   之后它们一直阻塞在work_ready上等活干。parallel_for()把[BEGIN, END)切成大小为GRAIN
+   的块，唤醒需要的工作线程，调用者自己也参与领取块，
+   最后等所有参与的工作线程都做完才返回。
+
+   块是按顺序领取的：领取只是把next往后挪GRAIN，关中断即可
+   保证原子性（单处理器）。同一时刻只允许一个任务，其他
+   调用者在job_lock上排队。 */
+
+/* 一次parallel_for()调用 */
+struct parallel_job {
+  size_t next;            /* 下一个未领取的下标 */
+  size_t end;             /* 结束下标（不含） */
+  size_t grain;           /* 每块的大小 */
+  parallel_func* fn;      /* 处理函数 */
+  void* aux;              /* 传给FN的参数 */
+  unsigned pending;       /* 还没做完的工作线程数 */
+  struct semaphore done;  /* 最后一个工作线程做完时up */
+};
+
+static struct thread* workers[PARALLEL_WORKERS]; /* 工作线程 */
+static size_t worker_cnt;                        /* 已启动的工作线程数 */
+static struct semaphore work_ready;              /* 每up一次唤醒一个工作线程 */
+static struct lock job_lock;                     /* 一次只跑一个任务 */
+static struct parallel_job* cur_job;             /* 正在跑的任务 */
+
+/* 统计 */
+static long long job_cnt;      /* 并行执行的任务数 */
+static long long inline_cnt;   /* 退化为串行执行的调用数 */
+static long long chunk_cnt;    /* 领取的块数 */
+static long long helped_cnt;   /* 工作线程领取的块数 */
+
+static bool workers_started;                     /* 是否已经尝试创建工作线程 */
+
+static thread_func worker_loop NO_RETURN;
+static void start_workers(void);
+static size_t run_chunks(struct parallel_job*);
+static bool is_worker(struct thread*);
+
+/* 初始化并行执行模块。工作线程推迟到第一次用时才创建，
+   不用的话不会多出线程来干扰调度 */
+void parallel_init(void) {
+  sema_init(&work_ready, 0);
+  lock_init(&job_lock);
+}
+
+/* 对[BEGIN, END)中的每一块调用FN(块起点, 块终点, AUX)，
+   每块最多GRAIN个下标，块之间可能并发执行。返回时所有块
+   都已处理完。
+
+   只有一块、或者在FN里嵌套调用时，直接在当前线程里按块
+   串行执行。嵌套调用可能发生在工作线程里，也可能发生在
+   持有job_lock、自己也在领块的调用者里，两种都要认出来，
+   否则后者会再去拿job_lock。 */
+void parallel_for(size_t begin, size_t end, size_t grain, parallel_func* fn, void* aux) {
+  struct parallel_job job;
+  size_t chunks, helpers, i;
+
+  ASSERT(fn != NULL);
+  ASSERT(!intr_context());
+
+  if (begin >= end)
+    return;
+  if (grain == 0)
+    grain = 1;
+
+  job.next = begin;
+  job.end = end;
+  job.grain = grain;
+  job.fn = fn;
+  job.aux = aux;
+
+  chunks = (end - begin - 1) / grain + 1;
+  if (chunks == 1 || is_worker(thread_current()) || lock_held_by_current_thread(&job_lock)) {
+    enum intr_level old_level = intr_disable();
+    inline_cnt++;
+    intr_set_level(old_level);
+    run_chunks(&job);
+    return;
+  }
+
+  lock_acquire(&job_lock);
+  if (!workers_started)
+    start_workers();
+  helpers = chunks - 1 < worker_cnt ? chunks - 1 : worker_cnt;
+  job.pending = helpers;
+  sema_init(&job.done, 0);
+  cur_job = &job;
+  job_cnt++;
+  for (i = 0; i < helpers; i++)
+    sema_up(&work_ready);
+
+  /* 调用者也参与，然后等工作线程做完 */
+  run_chunks(&job);
+  if (helpers > 0)
+    sema_down(&job.done);
+
+  cur_job = NULL;
+  lock_release(&job_lock);
+}
+
+/* 打印统计信息，没用过就不打印 */
+void parallel_print_stats(void) {
+  if (job_cnt == 0 && inline_cnt == 0)
+    return;
+  printf("Parallel: %zu workers, %lld jobs, %lld inline, %lld chunks (%lld by workers)\n",
+         worker_cnt, job_cnt, inline_cnt, chunk_cnt, helped_cnt);
+}
+
+/* 创建工作线程。调用者持有job_lock */
+static void start_workers(void) {
+  size_t i;
+
+  workers_started = true;
+  for (i = 0; i < PARALLEL_WORKERS; i++) {
+    struct semaphore started;
+    char name[16];
+
+    sema_init(&started, 0);
+    snprintf(name, sizeof name, "worker-%zu", i);
+    if (thread_create(name, PRI_DEFAULT, worker_loop, &started) == TID_ERROR)
+      break;
+    sema_down(&started);
+  }
+}
+
+/* 反复从JOB领取块并处理，直到领完。返回处理的块数 */
+static size_t run_chunks(struct parallel_job* job) {
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  for (;;) {
+    size_t start, stop;
+
+    old_level = intr_disable();
+    start = job->next;
+    stop = job->end - start > job->grain ? start + job->grain : job->end;
+    job->next = stop;
+    intr_set_level(old_level);
+
+    if (start >= stop)
+      break;
+    job->fn(start, stop, job->aux);
+    cnt++;
+  }
+
+  /* 统计数在各线程之间共用，和helped_cnt一样关中断再加 */
+  old_level = intr_disable();
+  chunk_cnt += cnt;
+  intr_set_level(old_level);
+  return cnt;
+}
+
+/* 工作线程的主循环 */
+static void worker_loop(void* started_) {
+  struct semaphore* started = started_;
+
+  workers[worker_cnt++] = thread_current();
+  sema_up(started);
+
+  for (;;) {
+    struct parallel_job* job;
+    enum intr_level old_level;
+    size_t cnt;
+
+    sema_down(&work_ready);
+    job = cur_job;
+    ASSERT(job != NULL);
+
+    cnt = run_chunks(job);
+
+    /* 最后一个做完的工作线程唤醒调用者。sema_up()之后
+       不能再碰JOB，它在调用者的栈上 */
+    old_level = intr_disable();
+    helped_cnt += cnt;
+    if (--job->pending == 0)
+      sema_up(&job->done);
+    intr_set_level(old_level);
+  }
+}
+
+/* T是否是工作线程 */
+static bool is_worker(struct thread* t) {
+  size_t i;
+
+  for (i = 0; i < worker_cnt; i++)
+    if (workers[i] == t)
+      return true;
+  return false;
+}
@@ -0,0 +1,16 @@
+#ifndef THREADS_PARALLEL_H
+#define THREADS_PARALLEL_H
+
+#include <stddef.h>
+
+/* 常驻内核工作线程的数量 */
+#define PARALLEL_WORKERS 8
+
+/* 处理[BEGIN, END)这一段下标的函数 */
+typedef void parallel_func(size_t begin, size_t end, void* aux);
+
+void parallel_init(void);
+void parallel_for(size_t begin, size_t end, size_t grain, parallel_func*, void* aux);
+void parallel_print_stats(void);
+
+#endif /* threads/parallel.h */
@@ -62,6 +62,11 @@ static inline uintptr_t pd_no(const void* va) { return (uintptr_t)va >> PDSHIFT;
 #define PTE_U 0x4            /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20           /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40           /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80          /* 1=4 MB page, 0=page table (PDEs only, needs CR4.PSE). */
+#define PTE_G 0x100          /* 1=global, survives CR3 loads (needs CR4.PGE). */
+
+/* Bytes covered by a 4 MB page. */
+#define LARGE_PGSIZE PTSPAN
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create(uint32_t* pt) {
@@ -73,9 +78,18 @@ static inline uint32_t pde_create(uint32_t* pt) {
    PDE, which must "present", points to. */
 static inline uint32_t* pde_get_pt(uint32_t pde) {
   ASSERT(pde & PTE_P);
+  ASSERT(!(pde & PTE_PS));
   return ptov(pde & PTE_ADDR);
 }
 
+/* Returns a PDE that maps the 4 MB page starting at PAGE, which
+   must be 4 MB aligned, readable and writable by the kernel
+   only. */
+static inline uint32_t pde_create_large(void* page) {
+  ASSERT(((uintptr_t)page & (LARGE_PGSIZE - 1)) == 0);
+  return vtop(page) | PTE_PS | PTE_P | PTE_W;
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
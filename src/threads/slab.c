@@ -0,0 +1,274 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* slab分配器。
+
+   每个缓存管理一种固定大小的对象。对象放在slab里，一个slab
+   就是一页：开头是struct slab，接着是空闲下标数组，然后是
+   对象本身。空闲链表用下标数组串起来而不是写进对象里，所以
+   对象释放后仍保持构造函数（或上一次使用）留下的状态，下次
+   分配不用重新初始化。
+
+   有空闲对象的slab在partial链表里，满的slab在full链表里。
+   全空的slab放在partial的末尾，最多留一个备用，再多就调用
+   析构函数后还给palloc。 */
+
+/* 检测slab损坏用的魔数 */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* 对象对齐 */
+#define SLAB_ALIGN sizeof(void*)
+
+/* 空闲链表结束 */
+#define SLAB_END UINT16_MAX
+
+/* 对象缓存 */
+struct kmem_cache {
+  const char* name;        /* 名字，用于统计 */
+  size_t obj_size;         /* 对象大小（已对齐） */
+  size_t req_size;         /* 创建时要求的大小 */
+  size_t obj_per_slab;     /* 每个slab的对象数 */
+  size_t obj_ofs;          /* 第一个对象在页内的偏移 */
+  kmem_ctor_func* ctor;    /* 构造函数，可以为空 */
+  kmem_dtor_func* dtor;    /* 析构函数，可以为空 */
+  struct lock lock;        /* 保护下面的成员 */
+  struct list partial;     /* 有空闲对象的slab，全空的在末尾 */
+  struct list full;        /* 没有空闲对象的slab */
+  size_t slab_cnt;         /* slab总数 */
+  size_t empty_cnt;        /* 全空的slab数 */
+  size_t in_use;           /* 正在使用的对象数 */
+  long long alloc_cnt;     /* 分配次数 */
+  long long hit_cnt;       /* 不用新建slab就满足的分配次数 */
+  long long grow_cnt;      /* 新建slab的次数 */
+  long long shrink_cnt;    /* 还给palloc的slab数 */
+  struct list_elem elem;   /* caches中的元素 */
+};
+
+/* slab头 */
+struct slab {
+  unsigned magic;            /* 总是SLAB_MAGIC */
+  struct kmem_cache* cache;  /* 所属的缓存 */
+  struct list_elem elem;     /* partial或full中的元素 */
+  size_t in_use;             /* 正在使用的对象数 */
+  uint16_t free_head;        /* 第一个空闲对象的下标 */
+  uint16_t next_free[];      /* 每个空闲对象的下一个空闲下标 */
+};
+
+static struct list caches; /* 所有缓存 */
+static struct lock caches_lock;
+
+static struct slab* slab_create(struct kmem_cache*);
+static void slab_destroy(struct kmem_cache*, struct slab*);
+static void* slab_obj(const struct kmem_cache*, struct slab*, size_t idx);
+
+/* 初始化slab分配器 */
+void slab_init(void) {
+  list_init(&caches);
+  lock_init(&caches_lock);
+}
+
+/* 创建管理SIZE字节对象的缓存，名字为NAME。CTOR和DTOR可以为空。
+   内存不够时返回空指针 */
+struct kmem_cache* kmem_cache_create(const char* name, size_t size, kmem_ctor_func* ctor,
+                                     kmem_dtor_func* dtor) {
+  struct kmem_cache* c;
+  size_t n;
+
+  ASSERT(size > 0);
+
+  c = malloc(sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  c->name = name;
+  c->req_size = size;
+  c->obj_size = ROUND_UP(size, SLAB_ALIGN);
+
+  /* 一页里能放下的最多对象数 */
+  n = (PGSIZE - sizeof(struct slab)) / (c->obj_size + sizeof(uint16_t));
+  while (n > 0 && ROUND_UP(sizeof(struct slab) + n * sizeof(uint16_t), SLAB_ALIGN) +
+                          n * c->obj_size > PGSIZE)
+    n--;
+  ASSERT(n > 0 && n < SLAB_END);
+  c->obj_per_slab = n;
+  c->obj_ofs = ROUND_UP(sizeof(struct slab) + n * sizeof(uint16_t), SLAB_ALIGN);
+
+  c->ctor = ctor;
+  c->dtor = dtor;
+  lock_init(&c->lock);
+  list_init(&c->partial);
+  list_init(&c->full);
+  c->slab_cnt = c->empty_cnt = c->in_use = 0;
+  c->alloc_cnt = c->hit_cnt = c->grow_cnt = c->shrink_cnt = 0;
+
+  lock_acquire(&caches_lock);
+  list_push_back(&caches, &c->elem);
+  lock_release(&caches_lock);
+  return c;
+}
+
+/* 销毁缓存C。C中的所有对象都必须已经释放 */
+void kmem_cache_destroy(struct kmem_cache* c) {
+  if (c == NULL)
+    return;
+
+  ASSERT(c->in_use == 0);
+  while (!list_empty(&c->partial)) {
+    slab_destroy(c, list_entry(list_pop_front(&c->partial), struct slab, elem));
+    c->empty_cnt--;
+  }
+
+  lock_acquire(&caches_lock);
+  list_remove(&c->elem);
+  lock_release(&caches_lock);
+  free(c);
+}
+
+/* 从C中分配一个对象。内存不够时返回空指针 */
+void* kmem_cache_alloc(struct kmem_cache* c) {
+  struct slab* s;
+  size_t idx;
+
+  lock_acquire(&c->lock);
+  c->alloc_cnt++;
+  if (list_empty(&c->partial)) {
+    s = slab_create(c);
+    if (s == NULL) {
+      lock_release(&c->lock);
+      return NULL;
+    }
+  } else {
+    c->hit_cnt++;
+    s = list_entry(list_front(&c->partial), struct slab, elem);
+  }
+
+  if (s->in_use++ == 0)
+    c->empty_cnt--;
+  c->in_use++;
+  idx = s->free_head;
+  s->free_head = s->next_free[idx];
+  if (s->free_head == SLAB_END) {
+    list_remove(&s->elem);
+    list_push_back(&c->full, &s->elem);
+  }
+  lock_release(&c->lock);
+
+  return slab_obj(c, s, idx);
+}
+
+/* 把OBJ还给C */
+void kmem_cache_free(struct kmem_cache* c, void* obj) {
+  struct slab* s;
+  size_t idx;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down(obj);
+  ASSERT(s->magic == SLAB_MAGIC);
+  ASSERT(s->cache == c);
+  ASSERT((pg_ofs(obj) - c->obj_ofs) % c->obj_size == 0);
+  idx = (pg_ofs(obj) - c->obj_ofs) / c->obj_size;
+  ASSERT(idx < c->obj_per_slab);
+
+#ifndef NDEBUG
+  /* 没有构造函数时对象状态没有意义，清掉以便发现释放后使用 */
+  if (c->ctor == NULL)
+    memset(obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire(&c->lock);
+  if (s->free_head == SLAB_END) {
+    list_remove(&s->elem);
+    list_push_front(&c->partial, &s->elem);
+  }
+  s->next_free[idx] = s->free_head;
+  s->free_head = idx;
+  c->in_use--;
+
+  if (--s->in_use == 0) {
+    /* 全空的slab挪到末尾，超过一个就还回去 */
+    list_remove(&s->elem);
+    if (c->empty_cnt > 0)
+      slab_destroy(c, s);
+    else {
+      list_push_back(&c->partial, &s->elem);
+      c->empty_cnt++;
+    }
+  }
+  lock_release(&c->lock);
+}
+
+/* 打印每个缓存的使用率和命中率 */
+void slab_print_stats(void) {
+  struct list_elem* e;
+
+  lock_acquire(&caches_lock);
+  for (e = list_begin(&caches); e != list_end(&caches); e = list_next(e)) {
+    struct kmem_cache* c = list_entry(e, struct kmem_cache, elem);
+    size_t capacity = c->slab_cnt * c->obj_per_slab;
+
+    printf("Cache %s: %zu-byte objects, %zu of %zu in use (%zu%%) in %zu slabs, "
+           "%lld allocs, %lld%% hits, %lld grows, %lld shrinks\n",
+           c->name, c->req_size, c->in_use, capacity,
+           capacity ? c->in_use * 100 / capacity : 0, c->slab_cnt, c->alloc_cnt,
+           c->alloc_cnt ? c->hit_cnt * 100 / c->alloc_cnt : 0, c->grow_cnt, c->shrink_cnt);
+  }
+  lock_release(&caches_lock);
+}
+
+/* 为C新建一个slab，构造其中所有对象，放在partial的最前面。
+   调用者持有C的锁 */
+static struct slab* slab_create(struct kmem_cache* c) {
+  struct slab* s;
+  size_t i;
+
+  s = palloc_get_page(0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->in_use = 0;
+  s->free_head = 0;
+  for (i = 0; i < c->obj_per_slab; i++) {
+    s->next_free[i] = i + 1 < c->obj_per_slab ? i + 1 : SLAB_END;
+    if (c->ctor != NULL)
+      c->ctor(slab_obj(c, s, i));
+  }
+
+  list_push_front(&c->partial, &s->elem);
+  c->slab_cnt++;
+  c->empty_cnt++;
+  c->grow_cnt++;
+  return s;
+}
+
+/* 析构全空的slab S中的所有对象，然后把它还给palloc。
+   调用者持有C的锁，S不在任何链表里 */
+static void slab_destroy(struct kmem_cache* c, struct slab* s) {
+  size_t i;
+
+  ASSERT(s->in_use == 0);
+  if (c->dtor != NULL)
+    for (i = 0; i < c->obj_per_slab; i++)
+      c->dtor(slab_obj(c, s, i));
+
+  c->slab_cnt--;
+  c->shrink_cnt++;
+  palloc_free_page(s);
+}
+
+/* 返回S中第IDX个对象 */
+static void* slab_obj(const struct kmem_cache* c, struct slab* s, size_t idx) {
+  return (uint8_t*)s + c->obj_ofs + idx * c->obj_size;
+}
@@ -0,0 +1,23 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* 对象缓存。每种频繁分配的内核结构一个缓存，对象大小精确，
+   空闲对象保留构造后的状态。 */
+struct kmem_cache;
+
+/* 构造函数和析构函数：对象所在的slab建立时调用CTOR，
+   slab还给palloc之前调用DTOR */
+typedef void kmem_ctor_func(void* obj);
+typedef void kmem_dtor_func(void* obj);
+
+void slab_init(void);
+struct kmem_cache* kmem_cache_create(const char* name, size_t size, kmem_ctor_func*,
+                                     kmem_dtor_func*);
+void kmem_cache_destroy(struct kmem_cache*);
+void* kmem_cache_alloc(struct kmem_cache*);
+void kmem_cache_free(struct kmem_cache*, void*);
+void slab_print_stats(void);
+
+#endif /* threads/slab.h */
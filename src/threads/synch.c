@@ -220,12 +220,10 @@ bool lock_try_acquire(struct lock* lock) {
   ASSERT(lock != NULL);
   ASSERT(!lock_held_by_current_thread(lock));
 
-  check_priority(lock);
-  thread_current()->lock=lock;
+  /*不等待，所以既不捐赠优先级，也不记录在等这把锁*/
   success = sema_try_down(&lock->semaphore);
   if (success)
     {
-      thread_current()->lock=NULL;
       lock->holder = thread_current();
       list_push_back(&lock->holder->locks,&lock->elem);
     }
@@ -449,3 +447,43 @@ void cond_broadcast(struct condition* cond, struct lock* lock) {
   while (!list_empty(&cond->waiters))
     cond_signal(cond, lock);
 }
+
+/* 初始化屏障BARRIER，每一轮需要COUNT个线程到达 */
+void barrier_init(struct barrier* barrier, unsigned count) {
+  ASSERT(barrier != NULL);
+  ASSERT(count > 0);
+
+  barrier->count = count;
+  barrier->waiting = 0;
+  barrier->generation = 0;
+  lock_init(&barrier->lock);
+  cond_init(&barrier->all_arrived);
+}
+
+/* 等待本轮的所有线程到达BARRIER。
+   最后一个到达的线程不睡眠，它唤醒其他线程并返回true，
+   其余线程返回false，方便调用者挑出一个线程做收尾工作。
+   被唤醒的线程还要重新获取锁，所以BARRIER的生命周期必须
+   长于所有等待者，不要把它放在会先返回的线程的栈上。 */
+bool barrier_wait(struct barrier* barrier) {
+  bool last;
+
+  ASSERT(barrier != NULL);
+  ASSERT(!intr_context());
+
+  lock_acquire(&barrier->lock);
+  if (++barrier->waiting == barrier->count) {
+    /* 开始新的一轮 */
+    barrier->waiting = 0;
+    barrier->generation++;
+    cond_broadcast(&barrier->all_arrived, &barrier->lock);
+    last = true;
+  } else {
+    unsigned generation = barrier->generation;
+    while (generation == barrier->generation)
+      cond_wait(&barrier->all_arrived, &barrier->lock);
+    last = false;
+  }
+  lock_release(&barrier->lock);
+  return last;
+}
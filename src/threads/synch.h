@@ -53,6 +53,18 @@ void rw_lock_init(struct rw_lock*);
 void rw_lock_acquire(struct rw_lock*, bool reader);
 void rw_lock_release(struct rw_lock*, bool reader);
 
+/* 屏障：COUNT个线程都到达后才一起继续执行，可重复使用 */
+struct barrier {
+  unsigned count;        /* 每一轮需要到达的线程数 */
+  unsigned waiting;      /* 本轮已经到达的线程数 */
+  unsigned generation;   /* 当前轮次，用于区分前后两轮 */
+  struct lock lock;
+  struct condition all_arrived;
+};
+
+void barrier_init(struct barrier*, unsigned count);
+bool barrier_wait(struct barrier*);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
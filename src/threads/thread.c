@@ -12,7 +12,6 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
-#include "filesys/file.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -216,11 +215,6 @@ tid_t thread_create(const char* name, int priority, thread_func* function, void*
   /*初始化可能正在等待的锁*/
   t->lock=NULL;
 
-  /*初始化文件链表*/
-  list_init(&t->open_files);
-  /*初始化文件描述符*/
-  t->cur_file_fd=3;
-
   /*初始化父进程与子进程通信的信号量*/
   sema_init(&t->wait_for_child,0);
 
@@ -367,34 +361,6 @@ struct thread* thread_current(void) {
 /* Returns the running thread's tid. */
 tid_t thread_tid(void) { return thread_current()->tid; }
 
-/*判断一个线程是否正在被执行*/
-bool is_executing(const char*name)
-{
-  struct list_elem*e;
-  for(e=list_begin(&all_list);e!=list_end(&all_list);e=list_next(e))
-  {
-    struct thread*tmp=list_entry(e,struct thread,allelem);
-    if(strcmp(tmp->name,name)==0)return true;
-  }
-  return false;
-}
-
-/*释放所有未close的文件*/
-void free_all_open_files()
-{
-  struct list_elem*e;
-  struct thread*cur=thread_current();
-  for(e=list_begin(&cur->open_files);e!=list_end(&cur->open_files);)
-  {
-    struct thread_file*to_be_free=list_entry(e,struct thread_file,elem_tf);
-    struct list_elem*tmp=e;
-    e=list_next(e);
-    file_close(to_be_free->f);
-    list_remove(tmp);
-    free(to_be_free);
-  }
-  
-}
 /* Deschedules the current thread and destroys it.  Never
    returns to the caller. */
 void thread_exit(void) {
@@ -408,7 +374,6 @@ void thread_exit(void) {
 #ifdef USERPROG
   free(thread_current()->child_process);
 #endif
-  free_all_open_files();
   thread_current()->status = THREAD_DYING;
   schedule();
   NOT_REACHED();
@@ -499,6 +464,10 @@ static void idle(void* idle_started_ UNUSED) {
   sema_up(idle_started);
 
   for (;;) {
+    /* 没别的线程可跑，先预先清零一些页，一次一页 */
+    while (palloc_idle_zero())
+      continue;
+
     /* Let someone else run. */
     intr_disable();
     thread_block();
@@ -86,14 +86,6 @@ typedef int tid_t;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread* initial_thread;
 
-struct thread_file{
-  /*一个文件系统相关的过渡结构体*/
-  int fd;
-  struct file*f;
-  struct list_elem elem_tf;
-  char name[16];
-};
-
 struct fpu_state{
   uint8_t fpu_registers[108];
 };
@@ -109,9 +101,6 @@ struct thread {
   int64_t wake_time;         /* 苏醒时间*/
   struct list_elem allelem;  /* List element for all threads list. */
 
-  int cur_file_fd;                  /*下一个使用的文件描述符*/
-  struct list open_files;           /*所有打开的文件*/
-
   int exit_status;                  /*退出状态*/
 
   /* Shared between thread.c and synch.c. */
@@ -128,6 +117,7 @@ struct thread {
   struct thread *father;            /*进程他爸*/
   struct semaphore wait_for_child;  /*调用wait时使用的信号量*/
   bool waited;                      /*该子进程是否已被等待过*/
+  void* user_esp;                   /*进入系统调用时的用户栈指针，内核缺页时用来判断栈增长*/
 
   /*浮点数状态保存*/
   struct fpu_state fs;  /*当前进程的fpu状态*/
@@ -169,7 +159,6 @@ void thread_unblock(struct thread*);
 struct thread* thread_current(void);
 tid_t thread_tid(void);
 const char* thread_name(void);
-bool is_executing(const char*);  //判断一个线程是否正在被执行
 void priority_insert_threads(struct thread *,struct list*);
 struct thread*find_highest_priority_and_dequeue(struct list*);
 
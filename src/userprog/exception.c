@@ -4,8 +4,13 @@
 #include "userprog/gdt.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -136,6 +141,26 @@ static void page_fault(struct intr_frame* f) {
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* 补充页表里登记过但还没载入的页：载入后返回，重新执行
+     出错的指令。写一个fork()后共用的页时复制一份。系统调用
+     里内核访问用户内存时也走这里 */
+  if (is_user_vaddr(fault_addr)) {
+    if (not_present ? page_load(fault_addr) : write && page_copy_on_write(fault_addr))
+      return;
+
+    /* 栈指针附近的访问让栈长一页。内核在系统调用里出错时
+       f->esp是内核栈，要用进入系统调用时保存的用户栈指针 */
+    if (not_present && page_in_stack(fault_addr, user ? f->esp : thread_current()->user_esp) &&
+        page_grow_stack(fault_addr))
+      return;
+  }
+#endif
+
+  /* 系统调用里访问用户内存出错，让访问用户内存的例程返回错误 */
+  if (!user && is_user_vaddr(fault_addr) && uaccess_fixup(f))
+    return;
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
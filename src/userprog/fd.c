@@ -0,0 +1,233 @@
+#include "userprog/fd.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
+
+/* 进程的文件描述符表。
+
+   表就是一个以描述符为下标的数组，元素指向打开的文件，空位
+   是空指针，查找只要一次下标运算。表满了按两倍扩大，最大到
+   FD_MAX。新描述符总是取最小的空位，FD_FREE记着可能空闲的
+   最小下标，比它小的都已经占用，找空位从它开始。
+
+   表属于进程而不是线程，进程里的所有线程看到同一组描述符。
+
+   描述符也可以指向管道的一端（见pipe.c），这时F为空。
+
+   控制台0和1不在表里，由系统调用直接处理，所以不能用dup()和
+   dup2()复制，也不能被dup2()覆盖或者关掉，这些调用返回-1。 */
+
+/* 表第一次分配时的大小 */
+#define FD_INIT_CAP 16
+
+/* struct thread_file的对象缓存 */
+static struct kmem_cache* thread_file_cache;
+
+static int install(struct file*, struct pipe*, bool writer);
+static bool grow(struct process*, int min_cap);
+static void put(struct thread_file*);
+
+/* 初始化描述符模块 */
+void fd_init(void) {
+  thread_file_cache = kmem_cache_create("thread_file", sizeof(struct thread_file), NULL, NULL);
+}
+
+/* 初始化PCB的空描述符表，第一次打开文件时才分配数组 */
+void fd_table_init(struct process* pcb) {
+  pcb->fds = NULL;
+  pcb->fd_cap = 0;
+  pcb->fd_free = FD_MIN;
+}
+
+/* 复制PARENT的描述符表给CHILD，CHILD的表要是空的。每个打开的
+   文件都重新打开一份，文件位置和PARENT的一样，管道则是两边共用；
+   PARENT里共用一个打开文件的描述符在CHILD里也共用一个。内存不够时返回false，
+   已经复制的部分留在CHILD的表里，由fd_table_destroy()释放 */
+bool fd_table_copy(struct process* child, struct process* parent) {
+  int i, j;
+
+  ASSERT(child->fds == NULL);
+  if (parent->fds == NULL)
+    return true;
+  if (!grow(child, parent->fd_cap))
+    return false;
+
+  for (i = FD_MIN; i < parent->fd_cap; i++) {
+    struct thread_file* tf = parent->fds[i];
+    struct thread_file* copy;
+
+    if (tf == NULL)
+      continue;
+    for (j = FD_MIN; j < i; j++)
+      if (parent->fds[j] == tf)
+        break;
+    if (j < i) {
+      copy = child->fds[j];
+      copy->ref_cnt++;
+    } else {
+      copy = kmem_cache_alloc(thread_file_cache);
+      if (copy == NULL)
+        return false;
+      *copy = *tf;
+      copy->ref_cnt = 1;
+      if (tf->pipe != NULL)
+        pipe_dup(tf->pipe, tf->writer);
+      else {
+        copy->f = file_reopen(tf->f);
+        if (copy->f == NULL) {
+          kmem_cache_free(thread_file_cache, copy);
+          return false;
+        }
+        file_seek(copy->f, file_tell(tf->f));
+      }
+    }
+    child->fds[i] = copy;
+  }
+  child->fd_free = parent->fd_free;
+  return true;
+}
+
+/* 关闭PCB的所有描述符，释放描述符表 */
+void fd_table_destroy(struct process* pcb) {
+  int i;
+
+  for (i = FD_MIN; i < pcb->fd_cap; i++)
+    if (pcb->fds[i] != NULL)
+      put(pcb->fds[i]);
+  free(pcb->fds);
+  fd_table_init(pcb);
+}
+
+/* 给打开的文件FILE分配当前进程最小的空闲描述符。描述符用完
+   或者内存不够时返回-1，这时调用者负责关闭FILE */
+int fd_install(struct file* file) { return install(file, NULL, false); }
+
+/* 给管道PIPE的写端（WRITER为真时）或读端分配当前进程最小的
+   空闲描述符。描述符用完或者内存不够时返回-1，这时调用者负责
+   关闭这一端 */
+int fd_install_pipe(struct pipe* pipe, bool writer) { return install(NULL, pipe, writer); }
+
+/* 返回当前进程描述符FD对应的打开文件，没有时返回空指针 */
+struct thread_file* fd_lookup(int fd) {
+  struct process* pcb = thread_current()->pcb;
+
+  if (fd < FD_MIN || fd >= pcb->fd_cap)
+    return NULL;
+  return pcb->fds[fd];
+}
+
+/* 关闭当前进程的描述符FD，FD没打开时返回false */
+bool fd_close(int fd) {
+  struct process* pcb = thread_current()->pcb;
+  struct thread_file* tf = fd_lookup(fd);
+
+  if (tf == NULL)
+    return false;
+  pcb->fds[fd] = NULL;
+  if (fd < pcb->fd_free)
+    pcb->fd_free = fd;
+  put(tf);
+  return true;
+}
+
+/* 让最小的空闲描述符和FD指向同一个打开的文件，返回新描述符。
+   FD是控制台、没打开或者描述符用完时返回-1 */
+int fd_dup(int fd) {
+  struct process* pcb = thread_current()->pcb;
+  struct thread_file* tf;
+  int new_fd;
+
+  if (fd < FD_MIN || (tf = fd_lookup(fd)) == NULL)
+    return -1;
+  for (new_fd = pcb->fd_free; new_fd < pcb->fd_cap && pcb->fds[new_fd] != NULL; new_fd++)
+    continue;
+  return fd_dup2(fd, new_fd);
+}
+
+/* 让NEW_FD和OLD_FD指向同一个打开的文件，NEW_FD原来打开着的话
+   先关掉。返回NEW_FD。两个中有一个是控制台、OLD_FD没打开或者
+   NEW_FD超出范围时返回-1 */
+int fd_dup2(int old_fd, int new_fd) {
+  struct process* pcb = thread_current()->pcb;
+  struct thread_file* tf;
+
+  if (old_fd < FD_MIN || new_fd < FD_MIN || new_fd >= FD_MAX)
+    return -1;
+  if ((tf = fd_lookup(old_fd)) == NULL)
+    return -1;
+  if (new_fd == old_fd)
+    return new_fd;
+  if (new_fd >= pcb->fd_cap && !grow(pcb, new_fd + 1))
+    return -1;
+
+  fd_close(new_fd);
+  tf->ref_cnt++;
+  pcb->fds[new_fd] = tf;
+  if (new_fd == pcb->fd_free)
+    pcb->fd_free = new_fd + 1;
+  return new_fd;
+}
+
+/* 给文件FILE或者管道PIPE的一端分配描述符 */
+static int install(struct file* file, struct pipe* pipe, bool writer) {
+  struct process* pcb = thread_current()->pcb;
+  struct thread_file* tf;
+  int fd;
+
+  for (fd = pcb->fd_free; fd < pcb->fd_cap && pcb->fds[fd] != NULL; fd++)
+    continue;
+  if (fd >= pcb->fd_cap && !grow(pcb, fd + 1))
+    return -1;
+
+  tf = kmem_cache_alloc(thread_file_cache);
+  if (tf == NULL)
+    return -1;
+  tf->f = file;
+  tf->pipe = pipe;
+  tf->writer = writer;
+  tf->ref_cnt = 1;
+  pcb->fds[fd] = tf;
+  pcb->fd_free = fd + 1;
+  return fd;
+}
+
+/* 把PCB的描述符表扩大到至少MIN_CAP项，超过FD_MAX或者内存不够
+   时返回false */
+static bool grow(struct process* pcb, int min_cap) {
+  struct thread_file** fds;
+  int cap;
+
+  if (min_cap <= pcb->fd_cap)
+    return true;
+  if (min_cap > FD_MAX)
+    return false;
+  cap = pcb->fd_cap > 0 ? pcb->fd_cap : FD_INIT_CAP;
+  while (cap < min_cap)
+    cap *= 2;
+  if (cap > FD_MAX)
+    cap = FD_MAX;
+
+  fds = realloc(pcb->fds, cap * sizeof *fds);
+  if (fds == NULL)
+    return false;
+  memset(fds + pcb->fd_cap, 0, (cap - pcb->fd_cap) * sizeof *fds);
+  pcb->fds = fds;
+  pcb->fd_cap = cap;
+  return true;
+}
+
+/* 去掉TF的一个引用，没有描述符指向它时关闭文件或管道的这一端 */
+static void put(struct thread_file* tf) {
+  if (--tf->ref_cnt == 0) {
+    if (tf->pipe != NULL)
+      pipe_close(tf->pipe, tf->writer);
+    else
+      file_close(tf->f);
+    kmem_cache_free(thread_file_cache, tf);
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef USERPROG_FD_H
+#define USERPROG_FD_H
+
+#include <stdbool.h>
+
+struct file;
+struct pipe;
+struct process;
+
+/* 0和1是控制台，打开的文件从2开始编号。控制台不在描述符表里，
+   不能dup()，dup2()的两端也不能是它 */
+#define FD_MIN 2
+/* 描述符的上限（不含） */
+#define FD_MAX 1024
+
+/* 打开的文件或者管道的一端。dup()出来的描述符共用同一个，
+   共享文件位置 */
+struct thread_file {
+  struct file* f;    /* 打开的文件，是管道时为空 */
+  struct pipe* pipe; /* 管道，是文件时为空 */
+  bool writer;       /* 是管道的写端 */
+  int ref_cnt;       /* 指向它的描述符个数 */
+};
+
+void fd_init(void);
+void fd_table_init(struct process*);
+bool fd_table_copy(struct process* child, struct process* parent);
+void fd_table_destroy(struct process*);
+
+int fd_install(struct file*);
+int fd_install_pipe(struct pipe*, bool writer);
+struct thread_file* fd_lookup(int fd);
+bool fd_close(int fd);
+int fd_dup(int fd);
+int fd_dup2(int old_fd, int new_fd);
+
+#endif /* userprog/fd.h */
@@ -159,6 +159,26 @@ void pagedir_set_dirty(uint32_t* pd, const void* vpage, bool dirty) {
   }
 }
 
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD. */
+void pagedir_set_writable(uint32_t* pd, const void* vpage, bool writable) {
+  uint32_t* pte = lookup_page(pd, vpage, false);
+  if (pte != NULL) {
+    if (writable)
+      *pte |= PTE_W;
+    else
+      *pte &= ~(uint32_t)PTE_W;
+    invalidate_pagedir(pd);
+  }
+}
+
+/* Returns true if virtual page VPAGE is mapped writable in PD.
+   Returns false if PD contains no PTE for VPAGE. */
+bool pagedir_is_writable(uint32_t* pd, const void* vpage) {
+  uint32_t* pte = lookup_page(pd, vpage, false);
+  return pte != NULL && (*pte & PTE_P) != 0 && (*pte & PTE_W) != 0;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD has been
    accessed recently, that is, between the time the PTE was
    installed and the last time it was cleared.  Returns false if
@@ -0,0 +1,241 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
+
+/* 进程间的管道。
+
+   管道里的数据放在一个由PIPE_PAGES个页组成的环里，每个缓冲区
+   是一页，记着还没读的那一段。环满了写者等，空了读者等。
+   写端都关了以后读者读完剩下的数据再读就返回0；读端都关了
+   以后写返回-1。
+
+   一般的写把数据复制到管道自己从内核池分配的页里，零碎的
+   写接在最后一页后面。有VM时，页对齐的整页写不复制，而是
+   用page_lend()把写者的帧借过来放进环里，写者那一页变成写时
+   复制；读的时候如果读者的缓冲区也是页对齐的整页，再用
+   page_take()把这一帧直接映射到读者的页上。这样一页数据从
+   生产者到消费者不经过任何复制。
+
+   描述符表（见fd.c）里的管道一端各自计数，fork()和dup()时
+   增加，关闭时减少，两端都没有了就释放管道。 */
+
+/* 环里的缓冲区数 */
+#define PIPE_PAGES 16
+
+/* 环里的一个缓冲区 */
+struct pipe_buf {
+  uint8_t* kpage;      /* 数据所在的页 */
+  struct frame* frame; /* 借来的写者的帧，KPAGE是管道自己的页时为空 */
+  size_t ofs;          /* 下一个要读的字节 */
+  size_t len;          /* 数据的结尾 */
+};
+
+/* 管道 */
+struct pipe {
+  struct lock lock;                 /* 保护下面所有成员 */
+  struct condition readable;        /* 有了数据或者写端都关了 */
+  struct condition writable;        /* 有了空位或者读端都关了 */
+  struct pipe_buf bufs[PIPE_PAGES]; /* 环 */
+  unsigned head;                    /* 下一个要读的缓冲区，只增不减 */
+  unsigned tail;                    /* 下一个要填的缓冲区，只增不减 */
+  int readers;                      /* 打开的读端数 */
+  int writers;                      /* 打开的写端数 */
+};
+
+/* 统计 */
+static long long pipe_cnt;  /* 建立的管道数 */
+static long long byte_cnt;  /* 写进管道的字节数 */
+static long long lent_cnt;  /* 借用写者的帧传的页数 */
+static long long remap_cnt; /* 直接映射给读者的页数 */
+
+static bool fill(struct pipe_buf*, const uint8_t* src, size_t size);
+static bool take(struct pipe_buf*, uint8_t* dst, size_t size);
+static void release(struct pipe_buf*);
+
+/* 建立一个读端和写端各打开一个的空管道，内存不够时返回空指针 */
+struct pipe* pipe_create(void) {
+  struct pipe* p = malloc(sizeof *p);
+
+  if (p == NULL)
+    return NULL;
+  lock_init(&p->lock);
+  cond_init(&p->readable);
+  cond_init(&p->writable);
+  p->head = p->tail = 0;
+  p->readers = p->writers = 1;
+  pipe_cnt++;
+  return p;
+}
+
+/* P的写端（WRITER为真时）或读端又多打开了一个 */
+void pipe_dup(struct pipe* p, bool writer) {
+  lock_acquire(&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release(&p->lock);
+}
+
+/* 关闭P的一个写端（WRITER为真时）或读端，两端都关完了就释放P */
+void pipe_close(struct pipe* p, bool writer) {
+  bool dead;
+
+  lock_acquire(&p->lock);
+  if (writer) {
+    ASSERT(p->writers > 0);
+    p->writers--;
+    cond_broadcast(&p->readable, &p->lock);
+  } else {
+    ASSERT(p->readers > 0);
+    p->readers--;
+    cond_broadcast(&p->writable, &p->lock);
+  }
+  dead = p->readers == 0 && p->writers == 0;
+  lock_release(&p->lock);
+
+  if (dead) {
+    while (p->head != p->tail)
+      release(&p->bufs[p->head++ % PIPE_PAGES]);
+    free(p);
+  }
+}
+
+/* 从P读最多SIZE个字节到用户缓冲区BUFFER，返回读到的字节数。
+   BLOCK为真时管道空了就等到有数据或者写端都关了，否则有多少
+   读多少，可能是0 */
+int pipe_read(struct pipe* p, void* buffer_, size_t size, bool block) {
+  uint8_t* buffer = buffer_;
+  size_t bytes_read = 0;
+
+  lock_acquire(&p->lock);
+  while (block && size > 0 && p->head == p->tail && p->writers > 0)
+    cond_wait(&p->readable, &p->lock);
+
+  while (bytes_read < size && p->head != p->tail) {
+    struct pipe_buf* b = &p->bufs[p->head % PIPE_PAGES];
+    size_t chunk = b->len - b->ofs;
+
+    if (chunk > size - bytes_read)
+      chunk = size - bytes_read;
+    if (!take(b, buffer + bytes_read, chunk))
+      memcpy(buffer + bytes_read, b->kpage + b->ofs, chunk);
+    b->ofs += chunk;
+    bytes_read += chunk;
+
+    if (b->ofs == b->len) {
+      release(b);
+      p->head++;
+      cond_signal(&p->writable, &p->lock);
+    }
+  }
+  lock_release(&p->lock);
+  return bytes_read;
+}
+
+/* 把用户缓冲区BUFFER里的SIZE个字节写进P，环满了就等。返回写进
+   的字节数；读端都关了或者内存不够时提前停下，一个字节都没写
+   就返回-1 */
+int pipe_write(struct pipe* p, const void* buffer_, size_t size) {
+  const uint8_t* buffer = buffer_;
+  size_t written = 0;
+
+  lock_acquire(&p->lock);
+  while (written < size && p->readers > 0) {
+    struct pipe_buf* b = &p->bufs[(p->tail - 1) % PIPE_PAGES];
+    size_t chunk;
+
+    if (p->head != p->tail && b->frame == NULL && b->len < PGSIZE) {
+      /* 接在最后一页后面 */
+      chunk = PGSIZE - b->len;
+      if (chunk > size - written)
+        chunk = size - written;
+      memcpy(b->kpage + b->len, buffer + written, chunk);
+      b->len += chunk;
+    } else if (p->tail - p->head == PIPE_PAGES) {
+      cond_wait(&p->writable, &p->lock);
+      continue;
+    } else {
+      b = &p->bufs[p->tail % PIPE_PAGES];
+      if (!fill(b, buffer + written, size - written))
+        break;
+      chunk = b->len;
+      p->tail++;
+    }
+    written += chunk;
+    cond_signal(&p->readable, &p->lock);
+  }
+  byte_cnt += written;
+  lock_release(&p->lock);
+  return written > 0 || size == 0 ? (int)written : -1;
+}
+
+/* 打印统计信息，没建过管道就不打印 */
+void pipe_print_stats(void) {
+  if (pipe_cnt == 0)
+    return;
+  printf("Pipes: %lld created, %lld bytes written, %lld pages lent, %lld pages remapped\n",
+         pipe_cnt, byte_cnt, lent_cnt, remap_cnt);
+}
+
+/* 用从用户地址SRC开始的最多SIZE个字节填空缓冲区B。SRC页对齐
+   并且至少有一整页时借用写者的帧，否则复制到新分配的页里。
+   内存不够时返回false */
+static bool fill(struct pipe_buf* b, const uint8_t* src, size_t size) {
+  b->ofs = 0;
+  b->len = size < PGSIZE ? size : PGSIZE;
+#ifdef VM
+  if (pg_ofs(src) == 0 && size >= PGSIZE && (b->frame = page_lend(src)) != NULL) {
+    b->kpage = b->frame->kpage;
+    lent_cnt++;
+    return true;
+  }
+#endif
+  b->frame = NULL;
+  b->kpage = palloc_get_page(0);
+  if (b->kpage == NULL)
+    return false;
+  memcpy(b->kpage, src, b->len);
+  return true;
+}
+
+#ifdef VM
+/* 缓冲区B里是借来的一整页，要读的SIZE个字节正好是这一整页，
+   并且用户地址DST页对齐时，把这一帧直接映射到DST上，B就不再
+   拥有它。做不到时返回false，由调用者复制 */
+static bool take(struct pipe_buf* b, uint8_t* dst, size_t size) {
+  if (b->frame == NULL || b->ofs != 0 || size != PGSIZE || pg_ofs(dst) != 0 ||
+      !page_take(dst, b->frame))
+    return false;
+  b->frame = NULL;
+  b->kpage = NULL;
+  remap_cnt++;
+  return true;
+}
+#else
+/* 没有VM时总是复制 */
+static bool take(struct pipe_buf* b UNUSED, uint8_t* dst UNUSED, size_t size UNUSED) {
+  return false;
+}
+#endif
+
+/* 释放读完了的缓冲区B的页 */
+static void release(struct pipe_buf* b) {
+#ifdef VM
+  if (b->frame != NULL) {
+    page_unlend(b->frame);
+    return;
+  }
+#endif
+  palloc_free_page(b->kpage);
+}
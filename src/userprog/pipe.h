@@ -0,0 +1,16 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct pipe;
+
+struct pipe* pipe_create(void);
+void pipe_dup(struct pipe*, bool writer);
+void pipe_close(struct pipe*, bool writer);
+int pipe_read(struct pipe*, void* buffer, size_t size, bool block);
+int pipe_write(struct pipe*, const void* buffer, size_t size);
+void pipe_print_stats(void);
+
+#endif /* userprog/pipe.h */
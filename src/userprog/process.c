@@ -6,8 +6,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/fd.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/ring.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -17,12 +20,26 @@
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 static struct semaphore temporary;
+
+/*切换线程时地址空间的统计*/
+static long long cr3_load_cnt;   /*重新加载CR3的次数*/
+static long long cr3_skip_cnt;   /*同一进程，不用加载的次数*/
+static long long cr3_borrow_cnt; /*内核线程借用上一个页目录的次数*/
+
 static thread_func start_process NO_RETURN;
+#ifdef VM
+static thread_func start_fork NO_RETURN;
+#endif
 static thread_func start_pthread NO_RETURN;
 static bool load(const char* file_name, void (**eip)(void), void** esp);
 bool setup_thread(void (**eip)(void), void** esp);
@@ -44,6 +61,7 @@ void userprog_init(void) {
 
   /* Kill the kernel if we did not succeed */
   ASSERT(success);
+  fd_table_init(t->pcb);
 }
 
 /* Starts a new thread running a user program loaded from
@@ -155,6 +173,9 @@ static void start_process(void* argvs_) {
     // Ensure that timer_interrupt() -> schedule() -> process_activate()
     // does not try to activate our uninitialized pagedir
     new_pcb->pagedir = NULL;
+    new_pcb->ring = NULL;
+    fd_table_init(new_pcb);
+    new_pcb->exec_file = NULL;
     t->pcb = new_pcb;
 
     // Continue initializing the PCB as normal
@@ -262,6 +283,123 @@ static void start_process(void* argvs_) {
     NOT_REACHED();
 }
 
+#ifdef VM
+/*传给fork出的子进程的参数*/
+struct fork_args {
+  struct thread* father;   /*父进程*/
+  struct intr_frame if_;   /*父进程进入系统调用时的中断帧*/
+};
+
+/* 复制当前进程。子进程的地址空间和父进程共用物理页，写时
+   才复制，打开的文件用file_reopen()复制一份、位置相同。
+   IF_是父进程进入fork系统调用时的中断帧，子进程从这里
+   返回用户态，返回值为0。返回子进程的pid，失败返回
+   TID_ERROR */
+pid_t process_fork(const struct intr_frame* if_) {
+  struct thread* cur = thread_current();
+  struct fork_args* args;
+  tid_t tid;
+
+  cur->pcb->is_child_loaded = false;
+  sema_init(&cur->pcb->from_child, 0);
+
+  args = malloc(sizeof *args);
+  if (args == NULL)
+    return TID_ERROR;
+  args->father = cur;
+  args->if_ = *if_;
+
+  tid = thread_create(cur->name, PRI_DEFAULT, start_fork, args);
+  if (tid != TID_ERROR)
+    sema_down(&cur->pcb->from_child);
+  free(args);
+
+  if (tid == TID_ERROR || !cur->pcb->is_child_loaded)
+    return TID_ERROR;
+  return tid;
+}
+
+/* fork出的子进程的线程函数。父进程在process_fork()里
+   等着，所以可以放心读它的状态 */
+static void start_fork(void* args_) {
+  struct fork_args* args = args_;
+  struct thread* t = thread_current();
+  struct thread* father = args->father;
+  struct process* parent = father->pcb;
+  struct intr_frame if_ = args->if_;
+  struct process* new_pcb;
+  bool success, pages_ready = false;
+
+  /*和start_process()一样初始化子进程列表，设置父子关系*/
+  struct list* cp = malloc(sizeof(struct list));
+  list_init(cp);
+  t->child_process = cp;
+  t->father = father;
+  list_push_back(father->child_process, &t->elem_process);
+
+  new_pcb = malloc(sizeof(struct process));
+  success = new_pcb != NULL;
+  if (success) {
+    new_pcb->pagedir = NULL;
+    new_pcb->ring = NULL;
+    fd_table_init(new_pcb);
+    new_pcb->exec_file = NULL;
+    page_readahead_init(&new_pcb->exec_ra);
+    list_init(&new_pcb->mappings);
+    new_pcb->next_mapid = 0;
+    t->pcb = new_pcb;
+    t->pcb->main_thread = t;
+    strlcpy(t->pcb->process_name, parent->process_name, sizeof t->pcb->process_name);
+
+    /*先建好空的地址空间，再和父进程共用所有页*/
+    new_pcb->pagedir = pagedir_create();
+    success = pages_ready = new_pcb->pagedir != NULL && page_table_init(&new_pcb->pages);
+    if (success) {
+      process_activate();
+      new_pcb->exec_file = file_reopen(parent->exec_file);
+      if (new_pcb->exec_file != NULL)
+        file_deny_write(new_pcb->exec_file);
+      success = new_pcb->exec_file != NULL && page_table_copy(new_pcb, parent) &&
+                fd_table_copy(new_pcb, parent);
+    }
+  }
+
+  if (!success) {
+    if (new_pcb != NULL) {
+      /*释放已经复制的部分。和process_exit()一样，先把
+        t->pcb置空、换回内核页目录，再销毁页目录*/
+      uint32_t* pd = new_pcb->pagedir;
+      if (pages_ready)
+        page_table_destroy(&new_pcb->pages);
+      fd_table_destroy(new_pcb);
+      file_close(new_pcb->exec_file);
+      t->pcb = NULL;
+      pagedir_activate(NULL);
+      if (pd != NULL)
+        pagedir_destroy(pd);
+      free(new_pcb);
+    }
+    sema_up(&father->pcb->from_child);
+    thread_exit();
+  }
+
+  /*浮点状态也和父进程一样*/
+  t->fs = father->fs;
+  asm volatile("frstor %0" : : "m"(t->fs.fpu_registers[0]));
+
+  father->pcb->is_child_loaded = true;
+  sema_up(&father->pcb->from_child);
+
+  /*子进程里fork()返回0*/
+  if_.eax = 0;
+  asm volatile("movl %0,%%esp;jmp intr_exit" : : "g"(&if_) : "memory");
+  NOT_REACHED();
+}
+#else
+/* 没有补充页表就没法写时复制，不支持fork() */
+pid_t process_fork(const struct intr_frame* if_ UNUSED) { return TID_ERROR; }
+#endif
+
 /*根据子进程的id返回子进程的指针，如果没找到则返回NULL*/
 struct thread *get_child_process(pid_t child_tid,struct thread*father)
 {
@@ -329,10 +467,24 @@ void process_exit(void) {
     NOT_REACHED();
   } 
 
+  /*先等异步I/O都做完，工作线程还在借用这个地址空间*/
+  ring_destroy();
+  fd_table_destroy(cur->pcb);
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pcb->pagedir;
   if (pd != NULL) {
+#ifdef VM
+    /* 先取消文件映射，写过的页写回文件；再释放补充页表，
+       它会清掉自己建立的映射 */
+    mmap_unmap_all();
+    page_table_destroy(&cur->pcb->pages);
+#endif
+    /*关闭可执行文件，别的进程又能写它了*/
+    file_close(cur->pcb->exec_file);
+    cur->pcb->exec_file = NULL;
+
     /* Correct ordering here is crucial.  We must set
          cur->pcb->pagedir to NULL before switching page directories,
          so that a timer interrupt can't switch back to the
@@ -359,21 +511,36 @@ void process_exit(void) {
 }
 
 /* Sets up the CPU for running user code in the current
-   thread. This function is called on every context switch. */
+   thread. This function is called on every context switch.
+
+   只有地址空间真的变了才重新加载CR3，加载CR3会冲掉TLB。
+   内核线程（以及还没有页目录的进程）不碰用户内存，直接
+   借用上一个线程的页目录。被借用的页目录不会在借用期间
+   销毁：进程销毁自己的页目录之前总是先换回init_page_dir。 */
 void process_activate(void) {
   struct thread* t = thread_current();
 
   /* Activate thread's page tables. */
-  if (t->pcb != NULL && t->pcb->pagedir != NULL)
-    pagedir_activate(t->pcb->pagedir);
-  else
-    pagedir_activate(NULL);
+  if (t->pcb != NULL && t->pcb->pagedir != NULL) {
+    if (active_pd() != t->pcb->pagedir) {
+      pagedir_activate(t->pcb->pagedir);
+      cr3_load_cnt++;
+    } else
+      cr3_skip_cnt++;
+  } else
+    cr3_borrow_cnt++;
 
   /* Set thread's kernel stack for use in processing interrupts.
      This does nothing if this is not a user process. */
   tss_update();
 }
 
+/* 打印切换地址空间的统计信息 */
+void process_print_stats(void) {
+  printf("Address space: %lld CR3 loads, %lld skipped (same process), %lld borrowed\n",
+         cr3_load_cnt, cr3_skip_cnt, cr3_borrow_cnt);
+}
+
 /* We load ELF binaries.  The following definitions are taken
    from the ELF specification, [ELF1], more-or-less verbatim.  */
 
@@ -450,6 +617,9 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
   struct file* file = NULL;
   off_t file_ofs;
   bool success = false;
+#ifdef VM
+  bool pages_ready = false;
+#endif
   int i;
 
   /* Allocate and activate page directory. */
@@ -458,12 +628,24 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
     goto done;
   process_activate();
 
+#ifdef VM
+  /* 各段只登记不读入，可执行文件要一直开着 */
+  if (!page_table_init(&t->pcb->pages))
+    goto done;
+  pages_ready = true;
+  page_readahead_init(&t->pcb->exec_ra);
+  list_init(&t->pcb->mappings);
+  t->pcb->next_mapid = 0;
+#endif
+
   /* Open executable file. */
   file = filesys_open(file_name);
   if (file == NULL) {
     printf("load: %s: open failed\n", file_name);
     goto done;
   }
+  /*运行期间一直开着，由inode层拒绝对它的写入*/
+  file_deny_write(file);
 
   /* Read and verify executable header. */
   if (file_read(file, &ehdr, sizeof ehdr) != sizeof ehdr ||
@@ -534,13 +716,23 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
 
 done:
   /* We arrive here whether the load is successful or not. */
+  if (success) {
+    t->pcb->exec_file = file;
+    return true;
+  }
+#ifdef VM
+  if (pages_ready)
+    page_table_destroy(&t->pcb->pages);
+#endif
   file_close(file);
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page(void* upage, void* kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -598,13 +790,38 @@ static bool validate_segment(const struct Elf32_Phdr* phdr, struct file* file) {
    user process if WRITABLE is true, read-only otherwise.
 
    Return true if successful, false if a memory allocation error
-   or disk read error occurs. */
+   or disk read error occurs.
+
+   With VM, the pages are only recorded in the supplemental page
+   table here and are read in by the page fault handler on first
+   access, a window of neighbouring pages at a time. */
 static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t read_bytes,
                          uint32_t zero_bytes, bool writable) {
   ASSERT((read_bytes + zero_bytes) % PGSIZE == 0);
   ASSERT(pg_ofs(upage) == 0);
   ASSERT(ofs % PGSIZE == 0);
 
+#ifdef VM
+  while (read_bytes > 0 || zero_bytes > 0) {
+    size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+    bool ok;
+
+    if (page_read_bytes > 0)
+      ok = page_add_file(upage, file, ofs, page_read_bytes, writable,
+                         &thread_current()->pcb->exec_ra);
+    else
+      ok = page_add_zero(upage, writable);
+    if (!ok)
+      return false;
+
+    read_bytes -= page_read_bytes;
+    zero_bytes -= PGSIZE - page_read_bytes;
+    ofs += page_read_bytes;
+    upage += PGSIZE;
+  }
+  return true;
+#else
+
   file_seek(file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) {
     /* Calculate how to fill this page.
@@ -637,11 +854,20 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
     upage += PGSIZE;
   }
   return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
    user virtual memory. */
 static bool setup_stack(void** esp) {
+#ifdef VM
+  /* start_process()马上要往栈里压参数，直接载入 */
+  void* upage = ((uint8_t*)PHYS_BASE) - PGSIZE;
+  if (!page_add_zero(upage, true) || !page_load(upage))
+    return false;
+  *esp = PHYS_BASE;
+  return true;
+#else
   uint8_t* kpage;
   bool success = false;
 
@@ -654,8 +880,10 @@ static bool setup_stack(void** esp) {
       palloc_free_page(kpage);
   }
   return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -673,6 +901,7 @@ static bool install_page(void* upage, void* kpage, bool writable) {
   return (pagedir_get_page(t->pcb->pagedir, upage) == NULL &&
           pagedir_set_page(t->pcb->pagedir, upage, kpage, writable));
 }
+#endif
 
 /* Returns true if t is the main thread of the process p */
 bool is_main_thread(struct thread* t, struct process* p) { return p->main_thread == t; }
@@ -3,6 +3,10 @@
 
 #include "threads/thread.h"
 #include <stdint.h>
+#ifdef VM
+#include <hash.h>
+#include "vm/page.h"
+#endif
 
 // At most 8MB can be allocated to the stack
 // These defines will be used in Project 2: Multithreading
@@ -17,6 +21,9 @@ typedef tid_t pid_t;
 typedef void (*pthread_fun)(void*);
 typedef void (*stub_fun)(pthread_fun, void*);
 
+struct ring_ctx;
+struct thread_file;
+
 struct communcate{
    char*fn_copy;
    struct thread*father;
@@ -36,14 +43,30 @@ struct process {
   pid_t pid;
   bool is_child_loaded;             /*子进程是否加载可执行表成功*/
   struct semaphore from_child;      /*调用exec时使用的信号量*/
+  struct ring_ctx* ring;            /*异步I/O的环，见userprog/ring.c*/
+  struct thread_file** fds;         /*文件描述符表，见userprog/fd.c*/
+  int fd_cap;                       /*fds的大小*/
+  int fd_free;                      /*可能空闲的最小描述符*/
+  struct file* exec_file;           /*可执行文件，运行期间拒绝写入*/
+
+#ifdef VM
+  struct hash pages;                /*补充页表，见vm/page.c*/
+  struct readahead exec_ra;         /*可执行文件的预读状态*/
+  struct list mappings;             /*文件映射，见vm/mmap.c*/
+  int next_mapid;                   /*下一个映射的编号*/
+#endif
 };
 
 void userprog_init(void);
 
+struct intr_frame;
+
 pid_t process_execute(const char* file_name);
+pid_t process_fork(const struct intr_frame*);
 int process_wait(pid_t);
 void process_exit(void);
 void process_activate(void);
+void process_print_stats(void);
 
 bool is_main_thread(struct thread*, struct process*);
 pid_t get_pid(struct process*);
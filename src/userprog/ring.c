@@ -0,0 +1,319 @@
+#include "userprog/ring.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/fd.h"
+#include "userprog/process.h"
+#include "userprog/uaccess.h"
+
+/* 异步文件I/O的提交队列和完成队列，用户接口见lib/ring.h。
+
+   环就放在进程自己的内存里，内核只通过copy_from_user()和
+   copy_to_user()访问，所以不用固定物理页。ring_enter()在进程
+   自己的上下文里把提交项拷进内核，解析文件描述符，排进全局
+   的请求队列，之后由常驻的工作线程执行。
+
+   工作线程执行一个请求时临时把自己的pcb设成提交者的，借用
+   提交者的地址空间，但不把用户缓冲区直接交给文件系统：请求
+   执行期间进程随时可能munmap()掉缓冲区甚至环本身，文件系统
+   在用户地址上缺页找不到页就只能杀死内核。所以每个工作线程
+   有自己的中转缓冲区，文件系统只读写它，用户缓冲区和环都只
+   用copy_to_user()和copy_from_user()访问，页没了只是这次拷贝
+   失败。进程退出前等所有交出去的请求都完成，保证工作线程
+   借用期间地址空间一直在。
+
+   完成队列必须能放下所有交出去的请求，ring_enter()交出的
+   请求数不会超过完成队列里剩下的空位。 */
+
+/* 工作线程的数量，也就是最多同时在执行的请求数 */
+#define RING_WORKERS 4
+
+/* 每个工作线程的中转缓冲区的页数，也就是一次读写文件的最多字节数 */
+#define RING_BOUNCE_PAGES 8
+#define RING_BOUNCE_SIZE (RING_BOUNCE_PAGES * PGSIZE)
+
+/* 一个进程的环在内核里的状态 */
+struct ring_ctx {
+  struct ring* uring;         /* 用户内存里的环 */
+  struct process* pcb;        /* 所属进程 */
+  uint32_t sq_head;           /* 内核自己的sq_head，不信任用户写回的值 */
+  uint32_t cq_tail;           /* 内核自己的cq_tail */
+  unsigned inflight;          /* 交给工作线程还没完成的请求数 */
+  struct lock lock;           /* 保护上面几项和完成队列 */
+  struct condition completed; /* 每完成一个请求广播一次 */
+};
+
+/* 排队等工作线程执行的请求 */
+struct ring_req {
+  struct ring_ctx* ctx;   /* 提交请求的环 */
+  struct ring_sqe sqe;    /* 拷进内核的提交项 */
+  struct file* file;      /* file_reopen()得到的，执行完关掉 */
+  struct list_elem elem;  /* 请求队列中的元素 */
+};
+
+static struct list queue;           /* 等待执行的请求 */
+static struct lock queue_lock;      /* 保护queue */
+static struct semaphore queue_cnt;  /* queue里的请求数 */
+static struct kmem_cache* req_cache; /* struct ring_req的对象缓存 */
+static size_t worker_cnt;           /* 已启动的工作线程数 */
+static struct lock workers_lock;    /* 保护worker_cnt */
+
+/* 统计 */
+static long long setup_cnt;    /* 建立的环数 */
+static long long enter_cnt;    /* ring_enter()的调用次数 */
+static long long submit_cnt;   /* 交给工作线程的请求数 */
+static long long max_inflight; /* 一个环上同时交出去的最多请求数 */
+
+static thread_func worker_loop NO_RETURN;
+static void start_workers(void);
+static struct ring_req* prepare(struct ring_ctx*, const struct ring_sqe*, int32_t* result);
+static int32_t execute(struct ring_req*, uint8_t* bounce);
+static void post(struct ring_ctx*, uint32_t user_data, int32_t result);
+
+/* 初始化异步I/O模块。工作线程推迟到第一次建立环时才创建 */
+void ring_init(void) {
+  list_init(&queue);
+  lock_init(&queue_lock);
+  sema_init(&queue_cnt, 0);
+  lock_init(&workers_lock);
+  req_cache = kmem_cache_create("ring_req", sizeof(struct ring_req), NULL, NULL);
+}
+
+/* 把用户地址URING处的环登记为当前进程的环，清零它的四个
+   下标。每个进程只能有一个环，地址不对或者已经有环时返回
+   false */
+bool ring_setup(struct ring* uring) {
+  struct process* pcb = thread_current()->pcb;
+  static const uint32_t zeros[4];
+  struct ring_ctx* ctx;
+
+  if (pcb->ring != NULL || !check_user(uring, sizeof *uring, true) ||
+      !copy_to_user(uring, zeros, sizeof zeros))
+    return false;
+
+  ctx = malloc(sizeof *ctx);
+  if (ctx == NULL)
+    return false;
+  ctx->uring = uring;
+  ctx->pcb = pcb;
+  ctx->sq_head = ctx->cq_tail = 0;
+  ctx->inflight = 0;
+  lock_init(&ctx->lock);
+  cond_init(&ctx->completed);
+
+  start_workers();
+  pcb->ring = ctx;
+  setup_cnt++;
+  return true;
+}
+
+/* 把提交队列里最多TO_SUBMIT个请求交给工作线程，然后等到完成
+   队列里至少有MIN_COMPLETE个没收割的完成项，或者交出去的请求
+   都完成了。返回交出的请求数，没有环或者环不能访问时返回-1。
+
+   提交项本身有错（文件描述符不对之类）的请求不交给工作线程，
+   直接在这里写一个结果为-1的完成项 */
+int ring_enter(unsigned to_submit, unsigned min_complete) {
+  struct ring_ctx* ctx = thread_current()->pcb->ring;
+  uint32_t sq_tail, cq_head;
+  unsigned submitted = 0;
+
+  if (ctx == NULL || !copy_from_user(&sq_tail, &ctx->uring->sq_tail, sizeof sq_tail) ||
+      !copy_from_user(&cq_head, &ctx->uring->cq_head, sizeof cq_head))
+    return -1;
+
+  enter_cnt++;
+  lock_acquire(&ctx->lock);
+  while (submitted < to_submit && ctx->sq_head != sq_tail &&
+         ctx->cq_tail - cq_head + ctx->inflight < RING_ENTRIES) {
+    struct ring_sqe sqe;
+    struct ring_req* req;
+    int32_t result;
+
+    if (!copy_from_user(&sqe, &ctx->uring->sq[ctx->sq_head % RING_ENTRIES], sizeof sqe))
+      break;
+    ctx->sq_head++;
+    submitted++;
+
+    req = prepare(ctx, &sqe, &result);
+    if (req == NULL) {
+      post(ctx, sqe.user_data, result);
+      continue;
+    }
+    ctx->inflight++;
+    if (ctx->inflight > max_inflight)
+      max_inflight = ctx->inflight;
+    submit_cnt++;
+
+    lock_acquire(&queue_lock);
+    list_push_back(&queue, &req->elem);
+    lock_release(&queue_lock);
+    sema_up(&queue_cnt);
+  }
+  copy_to_user(&ctx->uring->sq_head, &ctx->sq_head, sizeof ctx->sq_head);
+
+  while (ctx->inflight > 0 && ctx->cq_tail - cq_head < min_complete)
+    cond_wait(&ctx->completed, &ctx->lock);
+  lock_release(&ctx->lock);
+  return submitted;
+}
+
+/* 进程退出时调用：等交出去的请求都完成，然后释放环 */
+void ring_destroy(void) {
+  struct process* pcb = thread_current()->pcb;
+  struct ring_ctx* ctx = pcb->ring;
+
+  if (ctx == NULL)
+    return;
+  lock_acquire(&ctx->lock);
+  while (ctx->inflight > 0)
+    cond_wait(&ctx->completed, &ctx->lock);
+  lock_release(&ctx->lock);
+
+  pcb->ring = NULL;
+  free(ctx);
+}
+
+/* 打印统计信息，没用过就不打印 */
+void ring_print_stats(void) {
+  if (setup_cnt == 0)
+    return;
+  printf("Rings: %lld set up, %lld enters, %lld requests, %lld max in flight, %zu workers\n",
+         setup_cnt, enter_cnt, submit_cnt, max_inflight, worker_cnt);
+}
+
+/* 创建还没创建的工作线程，连同它们的中转缓冲区 */
+static void start_workers(void) {
+  lock_acquire(&workers_lock);
+  while (worker_cnt < RING_WORKERS) {
+    void* bounce = palloc_get_multiple(0, RING_BOUNCE_PAGES);
+    char name[16];
+
+    if (bounce == NULL)
+      break;
+    snprintf(name, sizeof name, "ring-%zu", worker_cnt);
+    if (thread_create(name, PRI_DEFAULT, worker_loop, bounce) == TID_ERROR) {
+      palloc_free_multiple(bounce, RING_BOUNCE_PAGES);
+      break;
+    }
+    worker_cnt++;
+  }
+  lock_release(&workers_lock);
+}
+
+/* 检查提交项SQE并生成请求。提交项不对时返回空指针，结果存到
+   *RESULT里。读写的范围要能用off_t表示，OFFSET加SIZE溢出时
+   也算不对。在提交者的上下文里调用，持有CTX->lock */
+static struct ring_req* prepare(struct ring_ctx* ctx, const struct ring_sqe* sqe,
+                                int32_t* result) {
+  struct thread_file* tf;
+  struct ring_req* req;
+
+  *result = -1;
+  if (sqe->op != RING_OP_READ && sqe->op != RING_OP_WRITE && sqe->op != RING_OP_FSYNC)
+    return NULL;
+  if ((int32_t)sqe->size < 0 || (tf = fd_lookup(sqe->fd)) == NULL || tf->f == NULL)
+    return NULL;
+  if (sqe->op != RING_OP_FSYNC &&
+      (sqe->offset > INT32_MAX || sqe->size > INT32_MAX - sqe->offset))
+    return NULL;
+
+  /* 自己打开一份，进程在请求完成前关掉描述符也没关系 */
+  req = kmem_cache_alloc(req_cache);
+  if (req == NULL)
+    return NULL;
+  req->file = file_reopen(tf->f);
+  if (req->file == NULL) {
+    kmem_cache_free(req_cache, req);
+    return NULL;
+  }
+  req->ctx = ctx;
+  req->sqe = *sqe;
+  return req;
+}
+
+/* 执行请求REQ，返回完成项的结果。工作线程借用着提交者的
+   地址空间，文件内容经过中转缓冲区BOUNCE，每次最多
+   RING_BOUNCE_SIZE字节。用户缓冲区不能访问时结果是-1，这时
+   可能已经读写了一部分 */
+static int32_t execute(struct ring_req* req, uint8_t* bounce) {
+  struct ring_sqe* sqe = &req->sqe;
+  uint8_t* ubuf = sqe->buffer;
+  off_t done = 0;
+
+  if (sqe->op == RING_OP_FSYNC)
+    /* 没有缓冲区缓存，写操作返回时数据已经写到磁盘上了 */
+    return 0;
+  ASSERT(sqe->op == RING_OP_READ || sqe->op == RING_OP_WRITE);
+
+  while (done < (off_t)sqe->size) {
+    off_t chunk = sqe->size - done < RING_BOUNCE_SIZE ? sqe->size - done : RING_BOUNCE_SIZE;
+    off_t n;
+
+    if (sqe->op == RING_OP_READ) {
+      n = file_read_at(req->file, bounce, chunk, sqe->offset + done);
+      if (!copy_to_user(ubuf + done, bounce, n))
+        return -1;
+    } else {
+      if (!copy_from_user(bounce, ubuf + done, chunk))
+        return -1;
+      n = file_write_at(req->file, bounce, chunk, sqe->offset + done);
+    }
+    done += n;
+    if (n < chunk)
+      break;
+  }
+  return done;
+}
+
+/* 往CTX的完成队列里写一项。调用者持有CTX->lock，并且在提交者
+   的地址空间里。环已经不能访问时这一项就丢了 */
+static void post(struct ring_ctx* ctx, uint32_t user_data, int32_t result) {
+  struct ring_cqe cqe = {user_data, result};
+
+  ASSERT(lock_held_by_current_thread(&ctx->lock));
+  copy_to_user(&ctx->uring->cq[ctx->cq_tail % RING_ENTRIES], &cqe, sizeof cqe);
+  ctx->cq_tail++;
+  copy_to_user(&ctx->uring->cq_tail, &ctx->cq_tail, sizeof ctx->cq_tail);
+  cond_broadcast(&ctx->completed, &ctx->lock);
+}
+
+/* 工作线程的主循环。BOUNCE是它的中转缓冲区 */
+static void worker_loop(void* bounce) {
+  struct thread* t = thread_current();
+
+  for (;;) {
+    struct ring_req* req;
+    struct ring_ctx* ctx;
+    int32_t result;
+
+    sema_down(&queue_cnt);
+    lock_acquire(&queue_lock);
+    req = list_entry(list_pop_front(&queue), struct ring_req, elem);
+    lock_release(&queue_lock);
+    ctx = req->ctx;
+
+    /* 借用提交者的地址空间 */
+    t->pcb = ctx->pcb;
+    process_activate();
+
+    result = execute(req, bounce);
+    file_close(req->file);
+
+    /* 放开ctx->lock之后进程可能马上退出，在那之前还回pcb */
+    lock_acquire(&ctx->lock);
+    post(ctx, req->sqe.user_data, result);
+    ctx->inflight--;
+    t->pcb = NULL;
+    lock_release(&ctx->lock);
+    kmem_cache_free(req_cache, req);
+  }
+}
@@ -0,0 +1,13 @@
+#ifndef USERPROG_RING_H
+#define USERPROG_RING_H
+
+#include <ring.h>
+#include <stdbool.h>
+
+void ring_init(void);
+bool ring_setup(struct ring*);
+int ring_enter(unsigned to_submit, unsigned min_complete);
+void ring_destroy(void);
+void ring_print_stats(void);
+
+#endif /* userprog/ring.h */
@@ -3,31 +3,142 @@
 #include<string.h>
 #include <syscall-nr.h>
 #include<float.h>
+#include<limits.h>
+#include <cpuid.h>
+#include <tsc.h>
 #include "threads/interrupt.h"
+#include "threads/loader.h"
 #include "threads/thread.h"
 #include "userprog/process.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
+#include "userprog/fd.h"
+#include "userprog/pipe.h"
+#include "userprog/ring.h"
+#include "userprog/tss.h"
+#include "userprog/uaccess.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include"threads/malloc.h"
+#include "threads/palloc.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 #include"devices/input.h"
 
+/*系统调用的处理函数。ARGS[1..]是已经拷进内核、按表里的标志检查过的参数，
+  返回值放到F->eax里*/
+typedef void syscall_func(struct intr_frame*f,uint32_t*args);
+
+/*参数检查标志*/
+#define SC_STR  0x1   /*参数1是用户字符串，先拷到内核页里再换成内核指针*/
+#define SC_RBUF 0x2   /*参数2、3是内核要读的用户缓冲区和长度*/
+#define SC_WBUF 0x4   /*参数2、3是内核要写的用户缓冲区和长度*/
+#define SC_NOBATCH 0x8 /*不能放进syscall_batch()里*/
+
+/*系统调用表的一项*/
+struct syscall_desc
+{
+  syscall_func*fn;    /*处理函数，空指针表示没实现*/
+  int argc;           /*参数个数*/
+  int flags;          /*SC_*的组合*/
+  const char*name;    /*打印统计用*/
+};
+
+static syscall_func sc_halt,sc_exit,sc_exec,sc_wait,sc_fork,sc_practice,sc_compute_e;
+static syscall_func sc_create,sc_remove,sc_open,sc_close,sc_filesize,sc_read,sc_write;
+static syscall_func sc_seek,sc_tell,sc_mmap,sc_munmap,sc_sysstat,sc_batch;
+static syscall_func sc_ring_setup,sc_ring_enter,sc_dup,sc_dup2;
+static syscall_func sc_pread,sc_pwrite,sc_readv,sc_writev,sc_copy_file_range,sc_pipe;
+
+/*按系统调用号索引*/
+static const struct syscall_desc syscalls[]=
+{
+  [SYS_HALT]={sc_halt,0,0,"halt"},
+  [SYS_EXIT]={sc_exit,1,0,"exit"},
+  [SYS_EXEC]={sc_exec,1,SC_STR,"exec"},
+  [SYS_WAIT]={sc_wait,1,0,"wait"},
+  [SYS_CREATE]={sc_create,2,SC_STR,"create"},
+  [SYS_REMOVE]={sc_remove,1,SC_STR,"remove"},
+  [SYS_OPEN]={sc_open,1,SC_STR,"open"},
+  [SYS_FILESIZE]={sc_filesize,1,0,"filesize"},
+  [SYS_READ]={sc_read,3,SC_WBUF,"read"},
+  [SYS_WRITE]={sc_write,3,SC_RBUF,"write"},
+  [SYS_SEEK]={sc_seek,2,0,"seek"},
+  [SYS_TELL]={sc_tell,1,0,"tell"},
+  [SYS_CLOSE]={sc_close,1,0,"close"},
+  [SYS_PRACTICE]={sc_practice,1,0,"practice"},
+  [SYS_COMPUTE_E]={sc_compute_e,1,0,"compute_e"},
+  [SYS_MMAP]={sc_mmap,2,0,"mmap"},
+  [SYS_MUNMAP]={sc_munmap,1,0,"munmap"},
+  [SYS_FORK]={sc_fork,0,SC_NOBATCH,"fork"},
+  [SYS_SYSSTAT]={sc_sysstat,2,0,"sysstat"},
+  [SYS_BATCH]={sc_batch,3,SC_NOBATCH,"batch"},
+  [SYS_RING_SETUP]={sc_ring_setup,1,0,"ring_setup"},
+  [SYS_RING_ENTER]={sc_ring_enter,2,0,"ring_enter"},
+  [SYS_DUP]={sc_dup,1,0,"dup"},
+  [SYS_DUP2]={sc_dup2,2,0,"dup2"},
+  [SYS_PREAD]={sc_pread,4,SC_WBUF,"pread"},
+  [SYS_PWRITE]={sc_pwrite,4,SC_RBUF,"pwrite"},
+  [SYS_READV]={sc_readv,3,0,"readv"},
+  [SYS_WRITEV]={sc_writev,3,0,"writev"},
+  [SYS_COPY_FILE_RANGE]={sc_copy_file_range,5,0,"copy_file_range"},
+  [SYS_PIPE]={sc_pipe,1,0,"pipe"},
+};
+#define SYSCALL_CNT (sizeof syscalls/sizeof *syscalls)
+#define SYSCALL_MAX_ARGS 5
+
+/*每个系统调用的次数和累计周期数。不加锁，统计偶尔丢一次无所谓*/
+static struct sysstat sc_stats[SYSCALL_CNT];
+
+/*SYSENTER用的MSR*/
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+/*从两种入口进来的次数*/
+static long long sysenter_cnt,int_cnt;
+
+void sysenter_entry(void);
 static void syscall_handler(struct intr_frame*);
-bool check_string(const char*);
-bool check_ptr(uint32_t*);
-struct thread_file*find_file(int);
-void syscall_init(void) { intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall"); }
+static void dispatch(struct intr_frame*,uint32_t,uint32_t*);
+static void wrmsr(uint32_t,uint32_t);
+static char* copy_in_string(const char*);
+static int rw_vector(int,const struct iovec*,int,bool);
+static int file_rw(struct file*,void*,int,off_t,bool);
+
+void syscall_init(void) {
+  intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
+  /*CPU支持的话再开SYSENTER入口，用户库会用同样的办法检测。
+    不支持时MSR_SYSENTER_CS是0，执行SYSENTER会#GP*/
+  if(cpu_has_sysenter())
+  {
+    wrmsr(MSR_SYSENTER_CS,SEL_KCSEG);
+    wrmsr(MSR_SYSENTER_ESP,(uint32_t)tss_sysenter_esp());
+    wrmsr(MSR_SYSENTER_EIP,(uint32_t)sysenter_entry);
+  }
+  fd_init();
+  ring_init();
+}
 void sys_exit(int);
 static void syscall_handler(struct intr_frame* f UNUSED) {
-  if(!check_ptr((uint32_t*)f->esp))
+  /*记下用户栈指针，系统调用里访问用户栈时可能要让栈增长*/
+  thread_current()->user_esp=f->esp;
+  if(f->error_code==1)
+  sysenter_cnt++;
+  else
+  int_cnt++;
+
+  /*系统调用号和参数都拷到内核里再用，地址不对时拷贝失败*/
+  const uint32_t*uargs=(const uint32_t*)f->esp;
+  uint32_t args[SYSCALL_MAX_ARGS+1];
+  if(!copy_from_user(args,uargs,sizeof args[0]))
   {
     sys_exit(-1);
     return;
   }
 
-  uint32_t*args = ((uint32_t*)f->esp);
-
   /*
    * The following print statement, if uncommented, will print out the syscall
    * number whenever a process enters a system call. You might find it useful
@@ -36,300 +147,549 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
    */
   //printf("System call number: %d\n", args[0]);
 
-  if (args[0] == SYS_EXIT) {
-    if(!check_ptr(&args[1]))
+  uint32_t nr=args[0];
+  if(nr>=SYSCALL_CNT||syscalls[nr].fn==NULL)
+  {
     f->eax=-1;
-    else
-    f->eax = args[1];
-    sys_exit(f->eax);
+    return;
   }
+  const struct syscall_desc*d=&syscalls[nr];
 
-  if(args[0]==SYS_PRACTICE)
+  /*按表里的参数个数一次拷完，再按标志检查*/
+  if(!copy_from_user(&args[1],&uargs[1],d->argc*sizeof(uint32_t)))
+  {
+    sys_exit(-1);
+    return;
+  }
+  dispatch(f,nr,args);
+}
+
+/*按表里的标志检查已经拷进内核的参数ARGS，然后调用NR的处理函数。
+  参数不对时杀死进程*/
+static void dispatch(struct intr_frame*f,uint32_t nr,uint32_t*args)
+{
+  const struct syscall_desc*d=&syscalls[nr];
+  char*kstr=NULL;
+  if(d->flags&SC_STR)
   {
-    if(!check_ptr(&args[1]))
+    if((kstr=copy_in_string((const char*)args[1]))==NULL)
     {
       sys_exit(-1);
       return;
     }
-    f->eax=args[1]+1;
+    args[1]=(uint32_t)kstr;
+  }
+  /*缓冲区每页试读（要写的话试写）一个字节，地址不对就在这里杀死进程。
+    这些页之后还可能被换出，交给文件系统时由file_rw()再钉住*/
+  if((d->flags&(SC_RBUF|SC_WBUF))&&((int)args[3]<0||!check_user((void*)args[2],args[3],d->flags&SC_WBUF)))
+  {
+    palloc_free_page(kstr);
+    sys_exit(-1);
+    return;
   }
 
-  if(args[0]==SYS_HALT)
+  /*exit和halt不会返回，只记次数*/
+  sc_stats[nr].calls++;
+  uint64_t start=rdtsc();
+  d->fn(f,args);
+  sc_stats[nr].cycles+=rdtsc()-start;
+  palloc_free_page(kstr);
+}
+
+/*打印每个用过的系统调用的次数和平均周期数*/
+void syscall_print_stats(void)
+{
+  if(sysenter_cnt>0||int_cnt>0)
+  printf("Syscall entry: %lld via sysenter, %lld via int $0x30\n",sysenter_cnt,int_cnt);
+  for(size_t i=0;i<SYSCALL_CNT;i++)
   {
-    shutdown_power_off();
+    const struct sysstat*s=&sc_stats[i];
+    if(s->calls>0)
+    printf("Syscall %s: %llu calls, %llu cycles/call\n",syscalls[i].name,s->calls,s->cycles/s->calls);
   }
+}
 
-  if(args[0]==SYS_EXEC)
+static void sc_halt(struct intr_frame*f UNUSED,uint32_t*args UNUSED)
+{
+  shutdown_power_off();
+}
+
+static void sc_exit(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=args[1];
+  sys_exit(f->eax);
+}
+
+static void sc_practice(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=args[1]+1;
+}
+
+static void sc_exec(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=process_execute((const char*)args[1]);
+}
+
+static void sc_fork(struct intr_frame*f,uint32_t*args UNUSED)
+{
+  f->eax=process_fork(f);
+}
+
+static void sc_wait(struct intr_frame*f,uint32_t*args)
+{
+  int ch_pid=args[1];
+  f->eax=process_wait(ch_pid);
+}
+
+/*以下是文件系统调用*/
+
+static void sc_create(struct intr_frame*f,uint32_t*args)
+{
+  int initial_size=args[2];
+  f->eax=filesys_create((const char*)args[1],initial_size);
+}
+
+static void sc_remove(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=filesys_remove((const char*)args[1]);
+}
+
+static void sc_open(struct intr_frame*f,uint32_t*args)
+{
+  const char*name=(const char*)args[1];
+  struct file*file=filesys_open(name);
+  if(file==NULL)
   {
-    if(!check_ptr(&args[1])||!check_string(args[1]))
-    {
-      sys_exit(-1);
-      return;
-    }
-    f->eax=process_execute(args[1]);
+    f->eax=-1;
+    return;
   }
+  int fd=fd_install(file);
+  if(fd<0)
+  file_close(file);//必须释放资源
+  f->eax=fd;
+}
 
-  if(args[0]==SYS_WAIT)
+static void sc_close(struct intr_frame*f UNUSED,uint32_t*args)
+{
+  fd_close(args[1]);
+}
+
+/*建立管道，读端和写端的描述符写到用户数组ARGS[1]里，
+  成功返回0，失败返回-1*/
+static void sc_pipe(struct intr_frame*f,uint32_t*args)
+{
+  int*ufds=(int*)args[1];
+  int fds[2];
+  struct pipe*p;
+
+  if(!check_user(ufds,sizeof fds,true))
   {
-    if(!check_ptr(&args[1]))
-    {
-      sys_exit(-1);
-      return;
-    }
-    int ch_pid=args[1];
-    f->eax=process_wait(ch_pid);
+    sys_exit(-1);
+    return;
+  }
+  f->eax=-1;
+  if((p=pipe_create())==NULL)
+  return;
+  if((fds[0]=fd_install_pipe(p,false))<0)
+  {
+    pipe_close(p,false);
+    pipe_close(p,true);
+    return;
+  }
+  if((fds[1]=fd_install_pipe(p,true))<0)
+  {
+    pipe_close(p,true);
+    fd_close(fds[0]);
+    return;
   }
+  if(!copy_to_user(ufds,fds,sizeof fds))
+  {
+    fd_close(fds[0]);
+    fd_close(fds[1]);
+    sys_exit(-1);
+    return;
+  }
+  f->eax=0;
+}
 
-  /*以下是文件系统调用*/
+static void sc_dup(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=fd_dup(args[1]);
+}
 
-  if(args[0]==SYS_CREATE)
+static void sc_dup2(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=fd_dup2(args[1],args[2]);
+}
+
+static void sc_filesize(struct intr_frame*f,uint32_t*args)
+{
+  int fd=args[1];
+  struct thread_file*tf=fd_lookup(fd);
+  if(!tf||!tf->f)
   {
-    if(!check_ptr(&args[1])||!check_ptr(&args[2])||!check_string(args[1]))
-    {
-      sys_exit(-1);
-      return;
-    }
-    char*file=args[1];
-    int initial_size=args[2];
-    f->eax=filesys_create(file,initial_size);
+    f->eax=-1;
+    return;
   }
+  f->eax=file_length(tf->f);
+}
+
+static void sc_read(struct intr_frame*f,uint32_t*args)
+{
+  int fd=args[1];
+  char*buffer=(char*)args[2];
+  int size=args[3];
 
-  if(args[0]==SYS_REMOVE)
+  if(fd==STDIN_FILENO)
   {
-    if(!check_ptr(&args[1]))
+    int total=0;
+    for(int i=0;i<size;i++)
     {
-      sys_exit(-1);
-      return;
+      buffer[i]=input_getc();
+      total++;
     }
-    char*file=args[1];
-    if(!check_string(file))
-    {
-      f->eax= false;
-      return;
-    }
-    bool success=filesys_remove(file);
-    f->eax=success;
+    f->eax=total;
+    return;
   }
+  struct thread_file*tf=fd_lookup(fd);
+  if(!tf)
+  {
+    f->eax=-1;
+    return;
+  }
+  if(tf->pipe)
+  {
+    f->eax=tf->writer?-1:pipe_read(tf->pipe,buffer,size,true);
+    return;
+  }
+  f->eax=file_rw(tf->f,buffer,size,-1,false);
+}
 
-  if(args[0]==SYS_OPEN)
+static void sc_write(struct intr_frame*f,uint32_t*args)
+{
+  int fd=args[1];
+  const char*buffer=(const char*)args[2];
+  int size=args[3];
+
+  if(fd==STDOUT_FILENO)
   {
-    if(!check_ptr(&args[1])||!check_string(args[1]))
-    {
-      sys_exit(-1);
-      return;
-    }
-    char*file=args[1];
-    struct thread*cur=thread_current();
-
-    struct thread_file* tmp=malloc(sizeof(struct thread_file));
-    tmp->fd=cur->cur_file_fd++;
-    strlcpy(tmp->name,file,sizeof(tmp->name));
-    tmp->f=filesys_open(file);
-    if(tmp->f==NULL)
-    {
-      f->eax=-1;
-      free(tmp);//必须释放资源
-      return;
-    }
-    list_push_back(&cur->open_files,&tmp->elem_tf);
-    f->eax=tmp->fd;
+    putbuf(buffer,size);
+    f->eax=size;
+    return;
+  }
+  struct thread_file*tf=fd_lookup(fd);
+  if(!tf)
+  {
+    f->eax=-1;
+    return;
   }
+  if(tf->pipe)
+  {
+    f->eax=tf->writer?pipe_write(tf->pipe,buffer,size):-1;
+    return;
+  }
+  /*正在运行的可执行文件被拒绝写入，inode层返回0*/
+  f->eax=file_rw(tf->f,(void*)buffer,size,-1,true);
+}
 
-  if(args[0]==SYS_CLOSE)
+/*从文件的ARGS[4]处读，不用也不改文件位置*/
+static void sc_pread(struct intr_frame*f,uint32_t*args)
+{
+  struct thread_file*tf=fd_lookup(args[1]);
+  if(!tf||!tf->f||(int)args[4]<0)
   {
-    if(!check_ptr(&args[1]))
-    {
-      sys_exit(-1);
-      return;
-    }
-    int fd=args[1];
-    struct thread_file*tf=find_file(fd);
-    if(!tf)
-    {
-      return;
-    }
-    file_close(tf->f);
-    list_remove(&tf->elem_tf);
-    free(tf);
+    f->eax=-1;
+    return;
   }
+  f->eax=file_rw(tf->f,(void*)args[2],args[3],args[4],false);
+}
 
-  if(args[0]==SYS_FILESIZE)
+/*写到文件的ARGS[4]处，不用也不改文件位置*/
+static void sc_pwrite(struct intr_frame*f,uint32_t*args)
+{
+  struct thread_file*tf=fd_lookup(args[1]);
+  if(!tf||!tf->f||(int)args[4]<0)
   {
-    if(!check_ptr(&args[1]))
-    {
-      sys_exit(-1);
-      return;
-    }
-    int fd=args[1];
-    struct thread_file*tf=find_file(fd);
-    if(!tf)
-    {
-      f->eax=-1;
-      return;
-    }
-    f->eax=file_length(tf->f);
+    f->eax=-1;
+    return;
   }
+  f->eax=file_rw(tf->f,(void*)args[2],args[3],args[4],true);
+}
 
-  if(args[0]==SYS_READ)
+static void sc_readv(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=rw_vector(args[1],(const struct iovec*)args[2],args[3],false);
+}
+
+static void sc_writev(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=rw_vector(args[1],(const struct iovec*)args[2],args[3],true);
+}
+
+/*按顺序对用户数组UIOV里的CNT个缓冲区读写FD，从文件位置开始连续
+  读写，返回总字节数。哪一段没读写满就停下。每段钉住以后直接交给
+  文件系统，整扇区的部分由inode层直接在用户缓冲区和磁盘之间传，
+  不经过内核的中转缓冲区*/
+static int rw_vector(int fd,const struct iovec*uiov,int cnt,bool write)
+{
+  struct iovec iov[IOV_MAX];
+  struct thread_file*tf=NULL;
+  int total=0;
+
+  if(cnt<0||cnt>IOV_MAX)
+  return -1;
+  if(!copy_from_user(iov,uiov,cnt*sizeof *iov))
   {
-    if(!check_ptr(&args[1])||!check_ptr(&args[2])||!check_ptr(&args[3]))
+    sys_exit(-1);
+    return -1;
+  }
+  /*先检查完所有缓冲区，不会读写到一半才被杀死*/
+  for(int i=0;i<cnt;i++)
+  {
+    if((int)iov[i].iov_len<0||total+(int)iov[i].iov_len<total||
+       !check_user(iov[i].iov_base,iov[i].iov_len,!write))
     {
       sys_exit(-1);
-      return;
+      return -1;
     }
-    int fd=args[1];
-    char*buffer=args[2];
-    int size=args[3];
+    total+=iov[i].iov_len;
+  }
+  if(fd!=(write?STDOUT_FILENO:STDIN_FILENO)&&(tf=fd_lookup(fd))==NULL)
+  return -1;
+  if(tf!=NULL&&tf->pipe!=NULL&&tf->writer!=write)
+  return -1;
 
-    if(!check_string(buffer))
+  total=0;
+  for(int i=0;i<cnt;i++)
+  {
+    int n=iov[i].iov_len;
+    if(tf==NULL&&write)
+    putbuf(iov[i].iov_base,n);
+    else if(tf==NULL)
     {
-      sys_exit(-1);
-      return;
+      for(int j=0;j<n;j++)
+      ((char*)iov[i].iov_base)[j]=input_getc();
     }
+    else if(tf->pipe&&write)
+    n=pipe_write(tf->pipe,iov[i].iov_base,n);
+    else if(tf->pipe)
+    n=pipe_read(tf->pipe,iov[i].iov_base,n,i==0);//读到一些以后不再等
+    else
+    n=file_rw(tf->f,iov[i].iov_base,n,-1,write);
+    if(n<0)
+    return total>0?total:-1;
+    total+=n;
+    if(n<(int)iov[i].iov_len)
+    break;
+  }
+  return total;
+}
 
-    if(fd==STDIN_FILENO)
-    {
-      int total=0;
-      for(int i=0;i<size;i++)
-      {
-        buffer[i]=input_getc();
-        total++;
-      }
-      f->eax=total;
-      return;
-    }
-    struct thread_file*tf=find_file(fd);
-    if(!tf)
-    {
-      f->eax=-1;
-      return;
-    }
-    f->eax=file_read(tf->f,buffer,size);
+/*把ARGS[1]从ARGS[2]开始的ARGS[5]个字节拷到ARGS[3]的ARGS[4]处，
+  数据只在内核里走，不改两个描述符的文件位置。同一个文件的两个
+  区间不能重叠。区间的末尾超出int时只拷到INT_MAX为止*/
+static void sc_copy_file_range(struct intr_frame*f,uint32_t*args)
+{
+  struct thread_file*src=fd_lookup(args[1]);
+  struct thread_file*dst=fd_lookup(args[3]);
+  int src_ofs=args[2],dst_ofs=args[4],len=args[5];
+  if(!src||!dst||!src->f||!dst->f||src_ofs<0||dst_ofs<0||len<0)
+  {
+    f->eax=-1;
+    return;
+  }
+  /*截短以后两个偏移加上LEN都不会溢出*/
+  if(len>INT_MAX-(src_ofs>dst_ofs?src_ofs:dst_ofs))
+  len=INT_MAX-(src_ofs>dst_ofs?src_ofs:dst_ofs);
+  if(file_get_inode(src->f)==file_get_inode(dst->f)&&
+     src_ofs<dst_ofs+len&&dst_ofs<src_ofs+len)
+  {
+    f->eax=-1;
+    return;
   }
+  f->eax=file_copy_range(dst->f,dst_ofs,src->f,src_ofs,len);
+}
 
-  if(args[0]==SYS_WRITE)
+static void sc_tell(struct intr_frame*f,uint32_t*args)
+{
+  int fd=args[1];
+  struct thread_file*tf=fd_lookup(fd);
+  if(tf!=NULL&&tf->f!=NULL)
   {
-    if(!check_ptr(&args[1])||!check_ptr(&args[2])||!check_ptr(&args[3]))
-    {
-      sys_exit(-1);
-      return;
-    }
-    int fd=args[1];
-    char*buffer=args[2];
-    int size=args[3];
+    f->eax=file_tell(tf->f);
+  }
+}
 
-    if(!check_string(buffer))
-    {
-      sys_exit(-1);
-      return;
-    }
-    if(fd==STDOUT_FILENO)
-    {
-      putbuf(buffer,size);
-      f->eax=size;
-      return;
-    }
-    struct thread_file*tf=find_file(fd);
-    if(!tf)
-    {
-      f->eax=-1;
-      return;
-    }
-    if(is_executing(tf->name))
-    {
-      f->eax=0;
-      return;
-    }
-    f->eax=file_write(tf->f,buffer,size);
+static void sc_seek(struct intr_frame*f UNUSED,uint32_t*args)
+{
+  int fd=args[1];
+  unsigned pos=args[2];
+  struct thread_file*tf=fd_lookup(fd);
+  if(tf!=NULL&&tf->f!=NULL)
+  {
+    file_seek(tf->f,pos);
   }
+}
 
-  if(args[0]==SYS_TELL)
+static void sc_mmap(struct intr_frame*f,uint32_t*args UNUSED)
+{
+  f->eax=-1;
+#ifdef VM
+  struct thread_file*tf=fd_lookup(args[1]);
+  if(tf!=NULL&&tf->f!=NULL)
   {
-    if(!check_ptr(&args[1]))
-    {
-      sys_exit(-1);
-      return;
-    }
-    int fd=args[1];
-    struct thread_file*tf=find_file(fd);
-    if(tf!=NULL)
-    {
-      f->eax=file_tell(tf->f);
-    }
+    f->eax=mmap_map(tf->f,(void*)args[2]);
+  }
+#endif
+}
+
+static void sc_munmap(struct intr_frame*f UNUSED,uint32_t*args UNUSED)
+{
+#ifdef VM
+  mmap_unmap(args[1]);
+#endif
+}
+
+static void sc_compute_e(struct intr_frame*f,uint32_t*args)
+{
+  asm volatile (
+    "fsave %0"
+    :: "m" (thread_current()->fs.fpu_registers[0]) // 将 FPU 状态保存到 fpu 结构中
+  );
+  f->eax=sys_sum_to_e(args[1]);
+  asm volatile (
+    "frstor %0"
+    :: "m" (thread_current()->fs.fpu_registers[0]) // 将 FPU 状态保存到 fpu 结构中
+  );
+}
+
+/*把系统调用ARGS[1]的统计拷到用户的ARGS[2]里，调用号不对时返回false*/
+static void sc_sysstat(struct intr_frame*f,uint32_t*args)
+{
+  uint32_t nr=args[1];
+  if(nr>=SYSCALL_CNT||syscalls[nr].fn==NULL)
+  {
+    f->eax=false;
+    return;
   }
+  if(!copy_to_user((void*)args[2],&sc_stats[nr],sizeof sc_stats[nr]))
+  {
+    sys_exit(-1);
+    return;
+  }
+  f->eax=true;
+}
+
+/*依次执行用户数组ARGS[1]里的ARGS[2]项系统调用，每项的返回值写回它的
+  result。ARGS[3]带BATCH_STOP_ON_ERROR时，返回值为负的那一项执行完就
+  停下。返回执行了的项数*/
+static void sc_batch(struct intr_frame*f,uint32_t*args)
+{
+  struct syscall_entry*uentries=(struct syscall_entry*)args[1];
+  int cnt=args[2];
+  unsigned flags=args[3];
+  int done;
 
-  if(args[0]==SYS_SEEK)
+  for(done=0;done<cnt;done++)
   {
-    if(!check_ptr(&args[1])||!check_ptr(&args[2]))
+    struct syscall_entry e;
+    uint32_t eargs[SYSCALL_MAX_ARGS+1];
+    if(!copy_from_user(&e,&uentries[done],sizeof e))
     {
       sys_exit(-1);
       return;
     }
-    int fd=args[1];
-    unsigned pos=args[2];
-    struct thread_file*tf=find_file(fd);
-    if(tf!=NULL)
+
+    /*每项在F的副本上执行，不会改掉这次调用自己的返回值*/
+    struct intr_frame ef=*f;
+    ef.eax=-1;
+    if(e.number<SYSCALL_CNT&&syscalls[e.number].fn!=NULL&&!(syscalls[e.number].flags&SC_NOBATCH))
     {
-      file_seek(tf->f,pos);
+      eargs[0]=e.number;
+      memcpy(&eargs[1],e.args,sizeof e.args);
+      dispatch(&ef,e.number,eargs);
     }
-  }
-
-  if(args[0]==SYS_COMPUTE_E)
-  {
-    if(!check_ptr(&args[1]))
+    int32_t result=ef.eax;
+    if(!copy_to_user(&uentries[done].result,&result,sizeof result))
     {
       sys_exit(-1);
       return;
     }
-    asm volatile (
-      "fsave %0"
-      :: "m" (thread_current()->fs.fpu_registers[0]) // 将 FPU 状态保存到 fpu 结构中
-  );
-    f->eax=sys_sum_to_e(args[1]);
-    asm volatile (
-      "frstor %0"
-      :: "m" (thread_current()->fs.fpu_registers[0]) // 将 FPU 状态保存到 fpu 结构中
-  );
+    if(result<0&&(flags&BATCH_STOP_ON_ERROR))
+    {
+      done++;
+      break;
+    }
   }
+  f->eax=done;
 }
 
-bool check_string(const char*being_checked)
+static void sc_ring_setup(struct intr_frame*f,uint32_t*args)
 {
-  if(being_checked==NULL||being_checked>PHYS_BASE)return false;
-  int i=0;
-  if(!is_user_vaddr(&being_checked[i])||!pagedir_get_page(thread_current()->pcb->pagedir,&being_checked[i]))
-  return false;
-  for(;being_checked[i]!='\0';i++)
-  {
-    if(!is_user_vaddr(&being_checked[i+1])||!pagedir_get_page(thread_current()->pcb->pagedir,&being_checked[i+1]))
-    return false;
-  }
-  return true;
+  f->eax=ring_setup((struct ring*)args[1]);
+}
+
+static void sc_ring_enter(struct intr_frame*f,uint32_t*args)
+{
+  f->eax=ring_enter(args[1],args[2]);
+}
+
+/*把VAL写进型号专用寄存器MSR*/
+static void wrmsr(uint32_t msr,uint32_t val)
+{
+  asm volatile("wrmsr"::"c"(msr),"a"(val),"d"(0));
 }
-bool check_ptr(uint32_t* unchecked)
+
+/*file_rw()每次钉住的最多页数*/
+#define PIN_PAGES 16
+
+/*读写文件FILE，用户缓冲区UBUF有SIZE字节。OFS小于0时从文件位置开始
+  并移动文件位置，否则从OFS处开始。整扇区的部分inode层在持有磁盘锁时
+  直接读写用户缓冲区，那时不能缺页，所以每次钉住一段缓冲区，做完放开
+  再做下一段，免得一个大缓冲区占住太多帧。段长是扇区的整数倍，不打乱
+  扇区对齐。返回读写的总字节数*/
+static int file_rw(struct file*file,void*ubuf,int size,off_t ofs,bool write)
 {
-  for(int i=0;i<4;i++)
+  const int max=(PIN_PAGES-1)*PGSIZE;//不对齐时也最多跨PIN_PAGES页
+  int total=0;
+  while(total<size)
   {
-    if(!is_user_vaddr(unchecked+i)||!pagedir_get_page(thread_current()->pcb->pagedir,unchecked+i))
-    return false;
+    uint8_t*p=(uint8_t*)ubuf+total;
+    int chunk=size-total<max?size-total:max;
+    int n;
+    if(!pin_user(p,chunk,!write))
+    break;
+    if(ofs<0)
+    n=write?file_write(file,p,chunk):file_read(file,p,chunk);
+    else
+    n=write?file_write_at(file,p,chunk,ofs+total):file_read_at(file,p,chunk,ofs+total);
+    unpin_user(p,chunk);
+    total+=n;
+    if(n<chunk)
+    break;
   }
-  return true;
+  return total;
 }
-struct thread_file*find_file(int fd)
+
+/*把用户字符串USTR拷到新分配的一页里返回，用完要palloc_free_page()。
+  地址不对、一页放不下或者内存不够时返回空指针*/
+static char* copy_in_string(const char*ustr)
 {
-  struct thread*cur=thread_current();
-  struct list_elem*e;
-  for(e=list_begin(&cur->open_files);e!=list_end(&cur->open_files);e=list_next(e))
+  char*kstr=palloc_get_page(0);
+  if(kstr==NULL)
+  return NULL;
+  int len=strncpy_from_user(kstr,ustr,PGSIZE);
+  if(len<0||len>=PGSIZE)
   {
-    struct thread_file*tmp=list_entry(e,struct thread_file,elem_tf);
-    if(tmp->fd==fd)
-    return tmp;
+    palloc_free_page(kstr);
+    return NULL;
   }
-  return NULL;
+  return kstr;
 }
+
 void sys_exit(int exit_status)
 {
   printf("%s: exit(%d)\n", thread_current()->pcb->process_name, exit_status);
   thread_current()->exit_status=exit_status;
   process_exit();
-}
\ No newline at end of file
+}
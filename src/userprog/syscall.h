@@ -3,5 +3,6 @@
 
 void syscall_init(void);
 void sys_exit(int);
+void syscall_print_stats(void);
 
 #endif /* userprog/syscall.h */
@@ -97,3 +97,13 @@ void tss_update(void) {
   ASSERT(tss != NULL);
   tss->esp0 = (uint8_t*)thread_current() + PGSIZE;
 }
+
+/* Returns the stack pointer that SYSENTER should load: the
+   address just past the esp0 member, so that sysenter_entry can
+   switch to the running thread's kernel stack with a single
+   "movl -4(%esp), %esp".  The TSS never moves, so the value
+   stays valid across thread switches. */
+void* tss_sysenter_esp(void) {
+  ASSERT(tss != NULL);
+  return &tss->esp0 + 1;
+}
@@ -0,0 +1,173 @@
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* 访问用户内存。
+
+   系统调用不再事先逐字节查页表，而是直接用usercopy.S里的
+   例程读写用户地址。地址合法时这就是一次普通的内存拷贝，
+   还没载入的页由缺页处理照常载入；地址不合法时缺页处理找
+   不到这一页，就查下面的修复表，把EIP改到例程的修复入口，
+   例程返回出错。这里只需要保证整个范围都在用户空间里，
+   避免碰到内核地址。 */
+
+/* usercopy.S里的例程 */
+size_t usercopy(void* dst, const void* src, size_t size);
+int usercopy_str(char* dst, const char* src, size_t size);
+
+/* 会访问用户内存的指令和它们的修复入口 */
+extern const char usercopy_insn[], usercopy_fixup[];
+extern const char usercopy_str_insn[], usercopy_str_fixup[];
+
+/* 修复表 */
+static const struct {
+  const char* insn;  /* 出错的指令 */
+  const char* fixup; /* 出错后接着执行的地址 */
+} fixups[] = {
+    {usercopy_insn, usercopy_fixup},
+    {usercopy_str_insn, usercopy_str_fixup},
+};
+
+/* 统计 */
+static long long fixup_cnt; /* 修复的出错次数 */
+
+/* UADDR开始的SIZE字节是否都在用户空间里 */
+static bool user_range(const void* uaddr, size_t size) {
+  uintptr_t start = (uintptr_t)uaddr;
+
+  return start + size >= start && start + size <= (uintptr_t)PHYS_BASE;
+}
+
+/* 从用户地址USRC拷贝SIZE字节到DST。有地址不能访问时返回false，
+   这时DST的内容不确定 */
+bool copy_from_user(void* dst, const void* usrc, size_t size) {
+  return user_range(usrc, size) && usercopy(dst, usrc, size) == 0;
+}
+
+/* 从SRC拷贝SIZE字节到用户地址UDST。有地址不能写时返回false，
+   这时可能已经写了一部分 */
+bool copy_to_user(void* udst, const void* src, size_t size) {
+  return user_range(udst, size) && usercopy(udst, src, size) == 0;
+}
+
+/* 把用户地址USRC处以空字符结尾的字符串拷贝到DST，DST有SIZE
+   字节。返回字符串的长度；字符串放不下（含空字符要超过SIZE
+   字节）时返回SIZE，这时DST不一定以空字符结尾；有地址不能
+   访问时返回-1 */
+int strncpy_from_user(char* dst, const char* usrc, size_t size) {
+  size_t max;
+  int len;
+
+  if (!is_user_vaddr(usrc))
+    return -1;
+  max = (const uint8_t*)PHYS_BASE - (const uint8_t*)usrc;
+  if (size <= max)
+    return usercopy_str(dst, usrc, size);
+
+  /* 一直读到了用户空间的尽头也没遇到空字符 */
+  len = usercopy_str(dst, usrc, max);
+  return len == (int)max ? -1 : len;
+}
+
+/* 检查用户地址UADDR开始的SIZE字节是否都能读，WRITE为真时还要
+   能写。每页只碰一个字节，写的时候写回原来的值；还没载入的
+   页这时会载入，但返回以后随时可能又被换出去。只用来在动手
+   之前确认地址合法，要把缓冲区直接交给文件系统必须用
+   pin_user() */
+bool check_user(const void* uaddr, size_t size, bool write) {
+  const uint8_t* p = uaddr;
+  const uint8_t* end = p + size;
+
+  if (size == 0)
+    return true;
+  if (!user_range(uaddr, size))
+    return false;
+  while (p < end) {
+    uint8_t c;
+
+    if (usercopy(&c, p, 1) != 0 || (write && usercopy((void*)p, &c, 1) != 0))
+      return false;
+    p = (const uint8_t*)pg_round_down(p) + PGSIZE;
+  }
+  return true;
+}
+
+/* 把用户地址UADDR开始的SIZE字节所在的页都钉在内存里，WRITE为真
+   时还要能写。直到unpin_user()之前这些页一直映射着，文件系统
+   可以在持有磁盘锁时直接读写它们。有页不能访问或者内存不够时
+   返回false，这时一页也没有钉住。没有虚拟内存时用户页一直在
+   内存里，只需要检查 */
+bool pin_user(const void* uaddr, size_t size, bool write) {
+#ifdef VM
+  const uint8_t* start = pg_round_down(uaddr);
+  const uint8_t* end = (const uint8_t*)uaddr + size;
+  const uint8_t* p;
+
+  if (size == 0)
+    return true;
+  if (!user_range(uaddr, size))
+    return false;
+  for (p = start; p < end; p += PGSIZE)
+    if (!page_pin(p, write)) {
+      while (p > start) {
+        p -= PGSIZE;
+        page_unpin(p);
+      }
+      return false;
+    }
+  return true;
+#else
+  return check_user(uaddr, size, write);
+#endif
+}
+
+/* 放开pin_user()钉住的UADDR开始的SIZE字节 */
+void unpin_user(const void* uaddr UNUSED, size_t size UNUSED) {
+#ifdef VM
+  const uint8_t* p = pg_round_down(uaddr);
+  const uint8_t* end = (const uint8_t*)uaddr + size;
+
+  if (size == 0)
+    return;
+  for (; p < end; p += PGSIZE)
+    page_unpin(p);
+#endif
+}
+
+/* UADDR开始的SIZE字节所在的页是否都已经用pin_user()钉住了。
+   没有虚拟内存时用户页一直在内存里，总是真 */
+bool user_pinned(const void* uaddr UNUSED, size_t size UNUSED) {
+#ifdef VM
+  const uint8_t* p = pg_round_down(uaddr);
+  const uint8_t* end = (const uint8_t*)uaddr + size;
+
+  if (!user_range(uaddr, size))
+    return false;
+  for (; p < end; p += PGSIZE)
+    if (!page_pinned(p))
+      return false;
+#endif
+  return true;
+}
+
+/* 内核访问用户地址出错时由page_fault()调用。出错的指令在
+   修复表里时把F的EIP改到修复入口并返回true */
+bool uaccess_fixup(struct intr_frame* f) {
+  size_t i;
+
+  for (i = 0; i < sizeof fixups / sizeof *fixups; i++)
+    if ((const char*)f->eip == fixups[i].insn) {
+      f->eip = (void (*)(void))fixups[i].fixup;
+      fixup_cnt++;
+      return true;
+    }
+  return false;
+}
+
+/* 打印统计信息 */
+void uaccess_print_stats(void) { printf("User access: %lld faults fixed up\n", fixup_cnt); }
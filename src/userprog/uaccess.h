@@ -0,0 +1,20 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct intr_frame;
+
+bool copy_from_user(void* dst, const void* usrc, size_t size);
+bool copy_to_user(void* udst, const void* src, size_t size);
+int strncpy_from_user(char* dst, const char* usrc, size_t size);
+bool check_user(const void* uaddr, size_t size, bool write);
+bool pin_user(const void* uaddr, size_t size, bool write);
+void unpin_user(const void* uaddr, size_t size);
+bool user_pinned(const void* uaddr, size_t size);
+
+bool uaccess_fixup(struct intr_frame*);
+void uaccess_print_stats(void);
+
+#endif /* userprog/uaccess.h */
@@ -0,0 +1,255 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+/* 帧表。
+
+   所有装着用户页的物理页排成一个环，用户池用完时按时钟
+   （二次机会）算法挑一帧换出：指针扫过的帧如果最近被访问
+   过，就清掉访问位再给一次机会，否则把它的页换出，帧留给
+   新的页用。访问位和脏位都在映射者的页表项里。
+
+   同一个可执行文件的只读段在所有运行它的进程之间共享：
+   这样的帧登记在共享帧表里，以(inode, 偏移, 读取字节数)
+   为键，映射它的页都挂在帧的pages链表上，链表长度就是
+   引用计数。最后一个页解除映射时帧才被释放。共享帧只要
+   有一个映射者最近访问过就不换出，换出时所有映射一起取消。
+
+   fork()之后父子进程的可写页也暂时映射同一帧（写时复制），
+   同样挂在pages上。这样的帧换出时内容只写一次交换区，
+   各个页共用那个槽。
+
+   管道传整页时把写者的帧借给管道（见page_lend()），LENT
+   记着借出的次数。借出的帧不换出，最后一个页解除映射时
+   也不释放，等管道还回来。
+
+   PINNED不为零的帧也不换出：内核正在往里复制内容，或者
+   系统调用钉住了映射它的用户页（见page_pin()）。
+
+   这里的函数只由page.c在持有页表锁时调用，所以本身不加锁。 */
+
+static struct kmem_cache* frame_cache; /* struct frame的对象缓存 */
+static struct list frames;             /* 所有帧组成的环 */
+static struct list_elem* hand;         /* 时钟指针，指向下一个要检查的帧 */
+static struct hash shared;             /* 共享帧表 */
+
+/* 统计 */
+static size_t frame_cnt;    /* 帧数 */
+static size_t frame_peak;   /* 帧数的峰值 */
+static size_t shared_cnt;   /* 共享帧表中的帧数 */
+static long long evict_cnt; /* 换出次数 */
+static long long scan_cnt;  /* 时钟指针走过的帧数 */
+
+static struct frame* evict(void);
+static struct frame* advance_hand(void);
+static bool test_and_clear_accessed(struct frame*);
+static bool evict_pages(struct frame*);
+static void unshare(struct frame*);
+static hash_hash_func frame_hash;
+static hash_less_func frame_less;
+
+/* 初始化帧表 */
+void frame_init(void) {
+  frame_cache = kmem_cache_create("frame", sizeof(struct frame), NULL, NULL);
+  list_init(&frames);
+  hand = list_end(&frames);
+  if (!hash_init(&shared, frame_hash, frame_less, NULL))
+    PANIC("shared frame table creation failed");
+}
+
+/* 分配一帧，返回时还没有页映射它。ZERO为真时帧的内容清零。
+   用户池满了就换出一页，换不出来返回空指针 */
+struct frame* frame_alloc(bool zero) {
+  struct frame* f;
+  void* kpage;
+
+  kpage = palloc_get_page(PAL_USER | (zero ? PAL_ZERO : 0));
+  if (kpage == NULL) {
+    f = evict();
+    if (f != NULL && zero)
+      memset(f->kpage, 0, PGSIZE);
+    return f;
+  }
+
+  f = kmem_cache_alloc(frame_cache);
+  if (f == NULL) {
+    palloc_free_page(kpage);
+    return NULL;
+  }
+  f->kpage = kpage;
+  list_init(&f->pages);
+  f->pinned = 0;
+  f->lent = 0;
+  f->inode = NULL;
+
+  /* 放在指针前面，转一圈以后才会被检查 */
+  list_insert(hand, &f->elem);
+  if (++frame_cnt > frame_peak)
+    frame_peak = frame_cnt;
+  return f;
+}
+
+/* 释放帧F，这时已经没有页映射它了 */
+void frame_free(struct frame* f) {
+  ASSERT(list_empty(&f->pages));
+  ASSERT(f->lent == 0);
+
+  unshare(f);
+  if (hand == &f->elem)
+    hand = list_next(hand);
+  list_remove(&f->elem);
+  frame_cnt--;
+  palloc_free_page(f->kpage);
+  kmem_cache_free(frame_cache, f);
+}
+
+/* 记下页P映射了帧F */
+void frame_add_page(struct frame* f, struct page* p) {
+  list_push_back(&f->pages, &p->frame_elem);
+  p->frame = f;
+}
+
+/* 页P不再映射帧F，F没有映射者也没有借出去就释放 */
+void frame_remove_page(struct frame* f, struct page* p) {
+  ASSERT(p->frame == f);
+
+  list_remove(&p->frame_elem);
+  p->frame = NULL;
+  if (list_empty(&f->pages) && f->lent == 0)
+    frame_free(f);
+}
+
+/* 返回内容是INODE中从OFS开始的READ_BYTES字节（其余为零）的
+   共享帧，没有则返回空指针 */
+struct frame* frame_lookup_shared(struct inode* inode, off_t ofs, uint32_t read_bytes) {
+  struct frame key;
+  struct hash_elem* e;
+
+  key.inode = inode;
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+  e = hash_find(&shared, &key.hash_elem);
+  return e != NULL ? hash_entry(e, struct frame, hash_elem) : NULL;
+}
+
+/* 把帧F登记为共享帧，内容是INODE中从OFS开始的READ_BYTES
+   字节。F的内容以后不能再改 */
+void frame_share(struct frame* f, struct inode* inode, off_t ofs, uint32_t read_bytes) {
+  ASSERT(f->inode == NULL);
+  ASSERT(inode != NULL);
+
+  f->inode = inode;
+  f->ofs = ofs;
+  f->read_bytes = read_bytes;
+  if (hash_insert(&shared, &f->hash_elem) != NULL) {
+    /* 已经有一样的了，这一帧就不共享 */
+    f->inode = NULL;
+    return;
+  }
+  shared_cnt++;
+}
+
+/* 打印统计信息，没有用户页就不打印 */
+void frame_print_stats(void) {
+  if (frame_peak == 0)
+    return;
+  printf("Frames: %zu in use, peak %zu, %zu shared, %lld evicted, %lld clock steps\n",
+         frame_cnt, frame_peak, shared_cnt, evict_cnt, scan_cnt);
+}
+
+/* 按时钟算法挑一帧，把映射它的页换出，返回空出来的帧。
+   最多扫两圈：第一圈清掉所有访问位，第二圈除非交换区满了
+   一定能找到 */
+static struct frame* evict(void) {
+  size_t i;
+
+  for (i = 0; i < 2 * frame_cnt; i++) {
+    struct frame* f = advance_hand();
+
+    scan_cnt++;
+    if (f->pinned > 0 || f->lent > 0 || test_and_clear_accessed(f) || !evict_pages(f))
+      continue;
+    unshare(f);
+    evict_cnt++;
+    return f;
+  }
+  return NULL;
+}
+
+/* 返回指针指向的帧，指针前移一格 */
+static struct frame* advance_hand(void) {
+  struct frame* f;
+
+  if (hand == list_end(&frames))
+    hand = list_begin(&frames);
+  f = list_entry(hand, struct frame, elem);
+  hand = list_next(hand);
+  return f;
+}
+
+/* 是否有映射者最近访问过F。同时清掉所有映射者的访问位 */
+static bool test_and_clear_accessed(struct frame* f) {
+  struct list_elem* e;
+  bool accessed = false;
+
+  for (e = list_begin(&f->pages); e != list_end(&f->pages); e = list_next(e)) {
+    struct page* p = list_entry(e, struct page, frame_elem);
+
+    if (pagedir_is_accessed(p->pagedir, p->upage)) {
+      pagedir_set_accessed(p->pagedir, p->upage, false);
+      accessed = true;
+    }
+  }
+  return accessed;
+}
+
+/* 换出映射F的所有页。只有要写交换区的帧可能失败，失败
+   时还没换出的页保持原样 */
+static bool evict_pages(struct frame* f) {
+  size_t slot = SWAP_ERROR;
+
+  while (!list_empty(&f->pages)) {
+    struct page* p = list_entry(list_front(&f->pages), struct page, frame_elem);
+
+    if (!page_evict(p, &slot)) {
+      ASSERT(f->inode == NULL);
+      return false;
+    }
+    list_remove(&p->frame_elem);
+    p->frame = NULL;
+  }
+  return true;
+}
+
+/* 把F从共享帧表里去掉 */
+static void unshare(struct frame* f) {
+  if (f->inode == NULL)
+    return;
+  hash_delete(&shared, &f->hash_elem);
+  f->inode = NULL;
+  shared_cnt--;
+}
+
+/* 以来源文件和偏移为键 */
+static unsigned frame_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct frame* f = hash_entry(e, struct frame, hash_elem);
+  return hash_bytes(&f->inode, sizeof f->inode) ^ hash_int(f->ofs);
+}
+
+static bool frame_less(const struct hash_elem* a_, const struct hash_elem* b_, void* aux UNUSED) {
+  const struct frame* a = hash_entry(a_, struct frame, hash_elem);
+  const struct frame* b = hash_entry(b_, struct frame, hash_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  return a->read_bytes < b->read_bytes;
+}
@@ -0,0 +1,38 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct inode;
+struct page;
+
+/* 帧表项。用户池里每个被占用的物理页一项 */
+struct frame {
+  void* kpage;           /* 内核虚拟地址 */
+  struct list pages;     /* 映射这一帧的页，共享帧可以有多个 */
+  struct list_elem elem; /* 时钟算法的环 */
+  int pinned;            /* 钉住的次数，不为零时不换出 */
+  int lent;              /* 借给管道的次数，不为零时不换出也不释放 */
+
+  /* 只读的文件页在进程之间共享，按内容的来源查找。
+     INODE为空表示不共享 */
+  struct inode* inode;        /* 来源文件 */
+  off_t ofs;                  /* 文件中的偏移 */
+  uint32_t read_bytes;        /* 从文件读的字节数 */
+  struct hash_elem hash_elem; /* 共享帧表中的元素 */
+};
+
+void frame_init(void);
+struct frame* frame_alloc(bool zero);
+void frame_free(struct frame*);
+void frame_add_page(struct frame*, struct page*);
+void frame_remove_page(struct frame*, struct page*);
+struct frame* frame_lookup_shared(struct inode*, off_t ofs, uint32_t read_bytes);
+void frame_share(struct frame*, struct inode*, off_t ofs, uint32_t read_bytes);
+void frame_print_stats(void);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,130 @@
+#include "vm/mmap.h"
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+
+/* 文件映射。
+
+   mmap()把文件的每一页登记到补充页表里，和可执行文件的
+   页一样在第一次访问时才读进来。这些页被换出时不进交换区：
+   写过的写回文件，没写过的直接丢掉，下次再从文件读。
+   munmap()和进程退出时把还在内存里、写过的页写回文件。
+
+   映射用的是file_reopen()得到的独立的file，所以关掉原来的
+   fd、甚至删掉文件以后映射仍然有效。fork()出的子进程不继承
+   映射。 */
+
+/* 一个文件映射 */
+struct mapping {
+  mapid_t id;            /* 映射的编号 */
+  struct file* file;     /* 映射的文件 */
+  uint8_t* base;         /* 起始用户地址 */
+  size_t page_cnt;       /* 页数 */
+  struct readahead ra;   /* 预读状态 */
+  struct list_elem elem; /* 进程的映射链表中的元素 */
+};
+
+static struct mapping* find_mapping(mapid_t);
+static void unmap(struct mapping*);
+
+/* 把FILE映射到当前进程从ADDR开始的地址上，返回映射的编号。
+   ADDR为0或者没有页对齐、文件长度为0、或者映射的范围和
+   已有的页重叠时返回MAP_FAILED */
+mapid_t mmap_map(struct file* file, void* addr) {
+  struct process* pcb = thread_current()->pcb;
+  struct mapping* m;
+  off_t length;
+  size_t i;
+
+  if (addr == NULL || pg_ofs(addr) != 0)
+    return MAP_FAILED;
+  length = file_length(file);
+  if (length == 0)
+    return MAP_FAILED;
+
+  /* 整个范围都要在用户空间里，并且还没有被占用 */
+  m = malloc(sizeof *m);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->base = addr;
+  m->page_cnt = DIV_ROUND_UP(length, PGSIZE);
+  if ((uintptr_t)m->base + m->page_cnt * PGSIZE > (uintptr_t)PHYS_BASE ||
+      (uintptr_t)m->base + m->page_cnt * PGSIZE < (uintptr_t)m->base)
+    goto fail;
+  for (i = 0; i < m->page_cnt; i++)
+    if (page_registered(m->base + i * PGSIZE))
+      goto fail;
+
+  m->file = file_reopen(file);
+  if (m->file == NULL)
+    goto fail;
+  page_readahead_init(&m->ra);
+  for (i = 0; i < m->page_cnt; i++) {
+    off_t ofs = i * PGSIZE;
+    uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+    if (!page_add_mmap(m->base + ofs, m->file, ofs, read_bytes, &m->ra)) {
+      m->page_cnt = i;
+      unmap(m);
+      return MAP_FAILED;
+    }
+  }
+
+  m->id = pcb->next_mapid++;
+  list_push_back(&pcb->mappings, &m->elem);
+  return m->id;
+
+fail:
+  free(m);
+  return MAP_FAILED;
+}
+
+/* 取消当前进程的映射ID。没有这个映射时返回false */
+bool mmap_unmap(mapid_t id) {
+  struct mapping* m = find_mapping(id);
+
+  if (m == NULL)
+    return false;
+  list_remove(&m->elem);
+  unmap(m);
+  return true;
+}
+
+/* 取消当前进程的所有映射，进程退出时调用 */
+void mmap_unmap_all(void) {
+  struct process* pcb = thread_current()->pcb;
+
+  while (!list_empty(&pcb->mappings)) {
+    struct mapping* m = list_entry(list_pop_front(&pcb->mappings), struct mapping, elem);
+    unmap(m);
+  }
+}
+
+/* 返回当前进程中编号为ID的映射 */
+static struct mapping* find_mapping(mapid_t id) {
+  struct process* pcb = thread_current()->pcb;
+  struct list_elem* e;
+
+  for (e = list_begin(&pcb->mappings); e != list_end(&pcb->mappings); e = list_next(e)) {
+    struct mapping* m = list_entry(e, struct mapping, elem);
+    if (m->id == id)
+      return m;
+  }
+  return NULL;
+}
+
+/* 删掉M的所有页，写过的写回文件，然后释放M */
+static void unmap(struct mapping* m) {
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    page_remove(m->base + i * PGSIZE);
+  file_close(m->file);
+  free(m);
+}
@@ -0,0 +1,787 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* 补充页表。
+
+   load()不再把可执行文件的每一页都读进来，而是只为每一页
+   登记一个struct page，记下文件、偏移和要读的字节数。
+   进程第一次访问某页时触发缺页，page_fault()调用page_load()
+   分配一页、读入内容并建立映射。从没被访问过的页既不占内存
+   也不用读盘。
+
+   内核在系统调用里访问用户内存时也可能缺页，同样由
+   page_load()处理，所以系统调用检查用户指针时只需查补充
+   页表，不必要求页已经在内存里。
+
+   用户池用完时frame_alloc()换出别的页。被写过的页换出到
+   交换区，再次访问时从交换区读回；没写过的页直接丢掉，
+   下次还从文件读或者清零。
+
+   不可写的文件页（可执行文件的代码段）在运行同一程序的
+   进程之间共享同一帧，见frame.c。
+
+   fork()只复制补充页表：子进程的每一页和父进程的对应页
+   映射同一帧，可写页在两边都映射成只读。谁先写谁触发
+   缺页，由page_copy_on_write()复制一份再改成可写。还在
+   交换区里的页共用同一个槽。
+
+   mmap()映射的页（见mmap.c）换出时写回文件，不进交换区。
+
+   管道（见userprog/pipe.c）传整页时不复制：写的时候
+   page_lend()把写者的帧借给管道，写者那一页和fork()之后
+   一样映射成只读，再写就复制；读的时候page_take()把借来的帧
+   直接映射到读者的页上，读者原来的帧放掉。
+
+   文件页缺页时顺便把后面紧挨着的几页也读进来并建立映射
+   （预读）。每段映射（可执行文件、每个mmap）各自记着上次
+   读到哪里：缺页正好落在上次读入的页之后，说明是顺序访问，
+   窗口加倍，否则减半，在RA_MIN_PAGES到RA_MAX_PAGES之间。
+   一个窗口在文件里是连续的，只发一次多扇区读。
+
+   用户栈开始只有一页。访问栈指针附近还没登记的地址时，
+   page_grow_stack()再登记一个全零页，栈就这样一页一页往下
+   长，最多MAX_STACK_PAGES页。
+
+   所有进程的缺页、换出和销毁都在vm_lock下串行进行，包括
+   其间的磁盘读写。补充页表的查找、插入和删除也在vm_lock下，
+   因为异步I/O的工作线程会借用进程的地址空间，在缺页时查
+   这个进程的表。
+
+   所以持有磁盘通道锁的线程不能缺页：缺页要等vm_lock，拿着
+   vm_lock的线程可能正在等同一个通道锁换出或者读文件，载入
+   这一页本身也可能要读同一块盘。文件系统整扇区地直接读写
+   用户缓冲区之前，系统调用先用page_pin()把缓冲区的页钉在
+   内存里，钉住的页不会被换出，也不会换成别的帧。 */
+
+/* struct page的对象缓存 */
+static struct kmem_cache* page_cache;
+
+/* 用户栈最低能长到的地址 */
+#define STACK_LIMIT ((uint8_t*)PHYS_BASE - MAX_STACK_PAGES * PGSIZE)
+
+/* 保护所有补充页表、帧表和页的内容 */
+static struct lock vm_lock;
+
+/* 有页的钉住次数降到零时广播，和vm_lock一起用 */
+static struct condition unpinned;
+
+/* 统计 */
+static long long added_cnt;  /* 登记的页数 */
+static long long loaded_cnt; /* 载入内存的页数 */
+static long long read_cnt;   /* 需要读文件的载入次数 */
+static long long swapin_cnt; /* 从交换区读回的次数 */
+static long long shared_cnt; /* 映射了已有共享帧的次数 */
+static long long fork_cnt;   /* 复制的页表数 */
+static long long cow_cnt;    /* 写时复制的页数 */
+static long long reuse_cnt;  /* 写时只剩自己用、直接改成可写的页数 */
+static long long mapped_cnt; /* 登记的文件映射页数 */
+static long long wb_cnt;     /* 写回文件的映射页数 */
+static long long stack_cnt;  /* 栈增长的页数 */
+static long long lent_cnt;   /* 借给管道的页数 */
+static long long taken_cnt;  /* 从管道直接映射过来的页数 */
+static long long ra_fault_cnt; /* 读文件的缺页数 */
+static long long ra_page_cnt;  /* 这些缺页读入的页数 */
+static long long ra_grow_cnt;  /* 窗口加倍的次数 */
+static long long ra_shrink_cnt; /* 窗口减半的次数 */
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_destroy;
+static struct page* lookup(const void* uaddr);
+static struct page* page_add(void* upage, struct file*, off_t ofs, uint32_t read_bytes,
+                             bool writable, struct readahead*);
+static bool load_around(struct page*);
+static void free_page(struct page*);
+static void write_back(struct page*);
+
+/* 初始化补充页表模块 */
+void page_init(void) {
+  page_cache = kmem_cache_create("page", sizeof(struct page), NULL, NULL);
+  lock_init(&vm_lock);
+  cond_init(&unpinned);
+}
+
+/* 初始化补充页表PAGES */
+bool page_table_init(struct hash* pages) { return hash_init(pages, page_hash, page_less, NULL); }
+
+/* 销毁补充页表PAGES，释放所有页占用的内存。必须在销毁
+   页目录之前调用 */
+void page_table_destroy(struct hash* pages) {
+  lock_acquire(&vm_lock);
+  hash_destroy(pages, page_destroy);
+  lock_release(&vm_lock);
+}
+
+/* 把PARENT的补充页表复制给CHILD。两边的可写页共用帧，
+   在各自的页目录里都映射成只读，谁先写谁复制。CHILD的
+   补充页表和页目录必须已经建好，它的可执行文件对应PARENT
+   的可执行文件。内存不够时返回false，已经复制的页在CHILD
+   退出时释放 */
+bool page_table_copy(struct process* child, struct process* parent) {
+  struct hash_iterator i;
+  bool success = true;
+
+  lock_acquire(&vm_lock);
+  hash_first(&i, &parent->pages);
+  while (hash_next(&i)) {
+    struct page* pp = hash_entry(hash_cur(&i), struct page, elem);
+    struct page* cp;
+
+    /* 子进程不继承文件映射 */
+    if (pp->mapped)
+      continue;
+
+    cp = kmem_cache_alloc(page_cache);
+    if (cp == NULL) {
+      success = false;
+      break;
+    }
+    cp->upage = pp->upage;
+    cp->pagedir = child->pagedir;
+    cp->writable = pp->writable;
+    cp->file = pp->file == parent->exec_file ? child->exec_file : pp->file;
+    cp->file_ofs = pp->file_ofs;
+    cp->read_bytes = pp->read_bytes;
+    cp->ra = pp->ra == &parent->exec_ra ? &child->exec_ra : NULL;
+    cp->frame = NULL;
+    cp->swap_slot = SWAP_ERROR;
+    cp->mapped = false;
+    cp->pinned = 0;
+
+    if (pp->frame != NULL) {
+      if (pp->writable) {
+        if (pagedir_is_dirty(parent->pagedir, pp->upage))
+          pp->dirty = true;
+        pagedir_set_writable(parent->pagedir, pp->upage, false);
+      }
+      if (!pagedir_set_page(child->pagedir, cp->upage, pp->frame->kpage, false)) {
+        kmem_cache_free(page_cache, cp);
+        success = false;
+        break;
+      }
+      frame_add_page(pp->frame, cp);
+    } else if (pp->swap_slot != SWAP_ERROR) {
+      swap_dup(pp->swap_slot);
+      cp->swap_slot = pp->swap_slot;
+    }
+    cp->dirty = pp->dirty;
+    hash_insert(&child->pages, &cp->elem);
+  }
+  fork_cnt++;
+  lock_release(&vm_lock);
+  return success;
+}
+
+/* 初始化一段映射的预读状态 */
+void page_readahead_init(struct readahead* ra) {
+  ra->next = NULL;
+  ra->window = RA_MIN_PAGES;
+}
+
+/* 为当前进程登记用户页UPAGE，内容是FILE中从OFS开始的
+   READ_BYTES字节，其余清零。RA是这一页所属映射的预读状态。
+   UPAGE已登记过时返回false */
+bool page_add_file(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                   bool writable, struct readahead* ra) {
+  ASSERT(file != NULL);
+  ASSERT(read_bytes <= PGSIZE);
+  return page_add(upage, file, ofs, read_bytes, writable, ra) != NULL;
+}
+
+/* 为当前进程登记全零的用户页UPAGE */
+bool page_add_zero(void* upage, bool writable) {
+  return page_add(upage, NULL, 0, 0, writable, NULL) != NULL;
+}
+
+/* 为当前进程登记映射FILE中从OFS开始的READ_BYTES字节的用户
+   页UPAGE。和page_add_file()不同，写过的内容会写回FILE */
+bool page_add_mmap(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                   struct readahead* ra) {
+  struct page* p;
+
+  ASSERT(file != NULL);
+  ASSERT(read_bytes <= PGSIZE);
+
+  p = page_add(upage, file, ofs, read_bytes, true, ra);
+  if (p == NULL)
+    return false;
+  p->mapped = true;
+  mapped_cnt++;
+  return true;
+}
+
+/* 从当前进程的补充页表里删掉UPAGE所在的页，释放它占用的
+   帧和交换槽。文件映射的页写过的话先写回文件 */
+void page_remove(void* upage) {
+  struct process* pcb = thread_current()->pcb;
+  struct page* p;
+
+  lock_acquire(&vm_lock);
+  p = lookup(upage);
+  if (p != NULL) {
+    hash_delete(&pcb->pages, &p->elem);
+    free_page(p);
+  }
+  lock_release(&vm_lock);
+}
+
+/* 当前进程是否登记过包含UADDR的页 */
+bool page_registered(const void* uaddr) {
+  bool found;
+
+  lock_acquire(&vm_lock);
+  found = lookup(uaddr) != NULL;
+  lock_release(&vm_lock);
+  return found;
+}
+
+/* 把当前进程中包含UADDR的页载入内存并建立映射。
+   UADDR没有登记过或者内存不够时返回false */
+bool page_load(const void* uaddr) {
+  struct page* p;
+  struct frame* f;
+  uint8_t* kpage;
+  bool success = false;
+
+  lock_acquire(&vm_lock);
+  p = lookup(uaddr);
+  if (p == NULL)
+    goto done;
+  if (p->frame != NULL) {
+    /* 等锁的时候别的线程已经载入了 */
+    success = true;
+    goto done;
+  }
+
+  /* 不可写的文件页先找有没有别的进程已经读进来了 */
+  if (p->file != NULL && !p->writable) {
+    f = frame_lookup_shared(file_get_inode(p->file), p->file_ofs, p->read_bytes);
+    if (f != NULL) {
+      if (!pagedir_set_page(p->pagedir, p->upage, f->kpage, false))
+        goto done;
+      frame_add_page(f, p);
+      shared_cnt++;
+      success = true;
+      goto done;
+    }
+  }
+
+  /* 文件页连同后面的几页一起读 */
+  if (p->file != NULL && p->swap_slot == SWAP_ERROR) {
+    success = load_around(p);
+    goto done;
+  }
+
+  /* 全零页尽量用空闲线程预先清零的页 */
+  f = frame_alloc(p->swap_slot == SWAP_ERROR);
+  if (f == NULL)
+    goto done;
+  kpage = f->kpage;
+
+  if (p->swap_slot != SWAP_ERROR) {
+    swap_in(p->swap_slot, kpage);
+    swap_free(p->swap_slot);
+    p->swap_slot = SWAP_ERROR;
+    swapin_cnt++;
+  }
+
+  if (!pagedir_set_page(p->pagedir, p->upage, kpage, p->writable)) {
+    frame_free(f);
+    goto done;
+  }
+  frame_add_page(f, p);
+
+  loaded_cnt++;
+  success = true;
+
+done:
+  lock_release(&vm_lock);
+  return success;
+}
+
+/* 把文件页P和它后面在文件里紧挨着、还没载入的页一起读进来
+   并建立映射。最多读预读窗口那么多页，遇到不在同一段映射、
+   已经在内存或交换区里、或者别的进程已经读进来的页就停下。
+   整段内容用一次file_read_at()读进临时缓冲区再分到各帧，
+   临时缓冲区分配不到时逐页读。调用者持有vm_lock */
+static bool load_around(struct page* p) {
+  struct readahead* ra = p->ra;
+  struct page* run[RA_MAX_PAGES];
+  struct frame* frames[RA_MAX_PAGES];
+  size_t window = RA_MIN_PAGES;
+  size_t cnt, i;
+  uint8_t* buf;
+  bool ok = true;
+
+  ASSERT(lock_held_by_current_thread(&vm_lock));
+
+  /* 调整窗口 */
+  if (ra != NULL) {
+    if (p->upage == ra->next) {
+      if (ra->window < RA_MAX_PAGES) {
+        ra->window *= 2;
+        ra_grow_cnt++;
+      }
+    } else if (ra->window > RA_MIN_PAGES) {
+      ra->window /= 2;
+      ra_shrink_cnt++;
+    }
+    window = ra->window;
+  }
+
+  /* 挑出窗口里能一起读的页 */
+  run[0] = p;
+  for (cnt = 1; cnt < window && run[cnt - 1]->read_bytes == PGSIZE; cnt++) {
+    struct page* q = lookup((uint8_t*)p->upage + cnt * PGSIZE);
+
+    if (q == NULL || q->file != p->file || q->ra != ra ||
+        q->file_ofs != p->file_ofs + (off_t)(cnt * PGSIZE) || q->frame != NULL ||
+        q->swap_slot != SWAP_ERROR)
+      break;
+    if (!q->writable &&
+        frame_lookup_shared(file_get_inode(q->file), q->file_ofs, q->read_bytes) != NULL)
+      break;
+    run[cnt] = q;
+  }
+
+  /* 分配帧。已经分到的帧要钉住，免得后面分配时又被换出去 */
+  for (i = 0; i < cnt; i++) {
+    frames[i] = frame_alloc(false);
+    if (frames[i] == NULL)
+      break;
+    frames[i]->pinned++;
+  }
+  if (i == 0)
+    return false;
+  cnt = i;
+
+  /* 读文件 */
+  buf = cnt > 1 ? palloc_get_multiple(0, cnt) : NULL;
+  if (buf != NULL) {
+    off_t size = (cnt - 1) * PGSIZE + run[cnt - 1]->read_bytes;
+
+    ok = file_read_at(p->file, buf, size, p->file_ofs) == size;
+    for (i = 0; i < cnt; i++)
+      memcpy(frames[i]->kpage, buf + i * PGSIZE, run[i]->read_bytes);
+    palloc_free_multiple(buf, cnt);
+  } else {
+    for (i = 0; i < cnt && ok; i++)
+      ok = file_read_at(run[i]->file, frames[i]->kpage, run[i]->read_bytes, run[i]->file_ofs) ==
+           (off_t)run[i]->read_bytes;
+  }
+  if (!ok) {
+    for (i = 0; i < cnt; i++)
+      frame_free(frames[i]);
+    return false;
+  }
+
+  /* 建立映射。后面的页映射失败就不要了，下次缺页再读 */
+  for (i = 0; i < cnt; i++) {
+    struct page* q = run[i];
+    struct frame* f = frames[i];
+
+    memset((uint8_t*)f->kpage + q->read_bytes, 0, PGSIZE - q->read_bytes);
+    f->pinned--;
+    if (!pagedir_set_page(q->pagedir, q->upage, f->kpage, q->writable)) {
+      frame_free(f);
+      if (i == 0)
+        ok = false;
+      continue;
+    }
+    frame_add_page(f, q);
+    if (!q->writable)
+      frame_share(f, file_get_inode(q->file), q->file_ofs, q->read_bytes);
+    loaded_cnt++;
+    read_cnt++;
+  }
+
+  if (ra != NULL)
+    ra->next = (uint8_t*)run[cnt - 1]->upage + PGSIZE;
+  ra_fault_cnt++;
+  ra_page_cnt += cnt;
+  return ok;
+}
+
+/* 访问UADDR是不是在用栈：UADDR在栈能长到的范围内，并且
+   不低于用户栈指针ESP以下32字节（PUSHA一次压32字节，会在
+   改ESP之前访问） */
+bool page_in_stack(const void* uaddr, const void* esp) {
+  return (const uint8_t*)uaddr >= STACK_LIMIT && is_user_vaddr(uaddr) &&
+         (const uint8_t*)uaddr >= (const uint8_t*)esp - 32;
+}
+
+/* 为当前进程在UADDR所在的位置添上一页栈并载入 */
+bool page_grow_stack(const void* uaddr) {
+  struct process* pcb = thread_current()->pcb;
+  void* upage = pg_round_down(uaddr);
+
+  if (pcb == NULL || pcb->pagedir == NULL)
+    return false;
+  if ((uint8_t*)upage < STACK_LIMIT || !page_add_zero(upage, true))
+    return false;
+  stack_cnt++;
+  return page_load(upage);
+}
+
+/* 处理对可写页的写保护缺页：UADDR所在的页因为和别的进程
+   共用一帧而映射成了只读。只剩自己用这一帧时直接改成
+   可写，否则复制一份。不是这种情况或者内存不够时返回
+   false。
+
+   复制会换掉这一页的帧，所以这一页钉住时要等它放开。这样的
+   缺页只会发生在借用地址空间的异步I/O工作线程里：钉住这一页
+   的是进程自己的线程，它正在系统调用里，不会等工作线程 */
+bool page_copy_on_write(const void* uaddr) {
+  struct page* p;
+  struct frame* old;
+  struct frame* f;
+  bool success = false;
+
+  lock_acquire(&vm_lock);
+  for (;;) {
+    p = lookup(uaddr);
+    if (p == NULL || !p->writable)
+      goto done;
+    old = p->frame;
+    if (old == NULL) {
+      /* 等锁的时候被换出了，重新载入后就是可写的 */
+      lock_release(&vm_lock);
+      return page_load(uaddr);
+    }
+
+    if (list_size(&old->pages) == 1 && old->lent == 0) {
+      pagedir_set_writable(p->pagedir, p->upage, true);
+      reuse_cnt++;
+      success = true;
+      goto done;
+    }
+    if (p->pinned == 0)
+      break;
+    cond_wait(&unpinned, &vm_lock);
+  }
+
+  /* 分配新帧时不能把要复制的帧换出去 */
+  old->pinned++;
+  f = frame_alloc(false);
+  old->pinned--;
+  if (f == NULL)
+    goto done;
+  memcpy(f->kpage, old->kpage, PGSIZE);
+
+  pagedir_clear_page(p->pagedir, p->upage);
+  if (!pagedir_set_page(p->pagedir, p->upage, f->kpage, true)) {
+    pagedir_set_page(p->pagedir, p->upage, old->kpage, false);
+    frame_free(f);
+    goto done;
+  }
+  frame_remove_page(old, p);
+  frame_add_page(f, p);
+  cow_cnt++;
+  success = true;
+
+done:
+  lock_release(&vm_lock);
+  return success;
+}
+
+/* 把当前进程中包含UADDR的页钉在内存里，直到page_unpin()：
+   不在内存就先载入，WRITE为真时还要映射成可写（写时复制的页
+   先复制一份），这样内核直接读写这一页时不会缺页。UADDR没有
+   登记过、要写但不可写或者内存不够时返回false。
+
+   钉住期间这一页一直映射同一帧：换出跳过钉住的帧，写时复制
+   等到这一页放开才复制，page_take()不接管钉住的页。page_lend()
+   和munmap()只由进程自己的线程做，而它正在系统调用里 */
+bool page_pin(const void* uaddr, bool write) {
+  for (;;) {
+    struct page* p;
+
+    lock_acquire(&vm_lock);
+    p = lookup(uaddr);
+    if (p == NULL || (write && !p->writable)) {
+      lock_release(&vm_lock);
+      return false;
+    }
+    if (p->frame != NULL && (!write || pagedir_is_writable(p->pagedir, p->upage))) {
+      p->pinned++;
+      p->frame->pinned++;
+      lock_release(&vm_lock);
+      return true;
+    }
+    lock_release(&vm_lock);
+
+    /* 载入以后、再拿到锁以前可能又被换出去了，那就再来一次 */
+    if (write ? !page_copy_on_write(uaddr) : !page_load(uaddr))
+      return false;
+  }
+}
+
+/* 放开page_pin()钉住的UADDR所在的页 */
+void page_unpin(const void* uaddr) {
+  struct page* p;
+
+  lock_acquire(&vm_lock);
+  p = lookup(uaddr);
+  ASSERT(p != NULL && p->pinned > 0);
+  ASSERT(p->frame != NULL && p->frame->pinned > 0);
+  p->frame->pinned--;
+  if (--p->pinned == 0)
+    cond_broadcast(&unpinned, &vm_lock);
+  lock_release(&vm_lock);
+}
+
+/* 当前进程中包含UADDR的页是否钉住了 */
+bool page_pinned(const void* uaddr) {
+  struct page* p;
+  bool pinned;
+
+  lock_acquire(&vm_lock);
+  p = lookup(uaddr);
+  pinned = p != NULL && p->pinned > 0;
+  lock_release(&vm_lock);
+  return pinned;
+}
+
+/* 把当前进程UPAGE处那一页的帧借给调用者，返回借出的帧，
+   之后它的内容不会再变：这一页可写的话映射成只读，进程再写
+   时由page_copy_on_write()复制一份。这一页不在内存里就先载入。
+   UPAGE没登记过、是文件映射或者共享的文件页时返回空指针。
+   用完要用page_take()或page_unlend()还回来 */
+struct frame* page_lend(const void* upage) {
+  struct page* p;
+  struct frame* f = NULL;
+
+  ASSERT(pg_ofs(upage) == 0);
+  if (!page_load(upage))
+    return NULL;
+
+  lock_acquire(&vm_lock);
+  /* 载入以后、拿到锁以前可能又被换出去了，这次不借 */
+  p = lookup(upage);
+  if (p == NULL || p->mapped || p->frame == NULL || p->frame->inode != NULL)
+    goto done;
+  f = p->frame;
+  if (p->writable) {
+    if (pagedir_is_dirty(p->pagedir, p->upage))
+      p->dirty = true;
+    pagedir_set_writable(p->pagedir, p->upage, false);
+  }
+  f->lent++;
+  lent_cnt++;
+
+done:
+  lock_release(&vm_lock);
+  return f;
+}
+
+/* 把page_lend()借出的帧F映射到当前进程的可写页UPAGE上，代替
+   UPAGE原来的内容，F的这次借出就还掉了。F还有别的映射者或者
+   还借给了别人时映射成只读，写的时候再复制。UPAGE没登记过、不可写、是
+   文件映射或者钉住了时返回false，F还是借出状态 */
+bool page_take(void* upage, struct frame* f) {
+  struct page* p;
+  bool success = false;
+
+  ASSERT(pg_ofs(upage) == 0);
+  lock_acquire(&vm_lock);
+  ASSERT(f->lent > 0);
+  p = lookup(upage);
+  if (p == NULL || !p->writable || p->mapped || p->pinned > 0)
+    goto done;
+  if (p->frame == f) {
+    /* 借出去的就是这一页，内容已经一样了 */
+    f->lent--;
+    success = true;
+    goto done;
+  }
+
+  if (p->frame != NULL) {
+    pagedir_clear_page(p->pagedir, p->upage);
+    frame_remove_page(p->frame, p);
+  }
+  if (p->swap_slot != SWAP_ERROR) {
+    swap_free(p->swap_slot);
+    p->swap_slot = SWAP_ERROR;
+  }
+  /* 内容和初始内容不同了，换出时要写交换区 */
+  p->dirty = true;
+  if (!pagedir_set_page(p->pagedir, p->upage, f->kpage, list_empty(&f->pages) && f->lent == 1))
+    goto done;
+  frame_add_page(f, p);
+  f->lent--;
+  taken_cnt++;
+  success = true;
+
+done:
+  lock_release(&vm_lock);
+  return success;
+}
+
+/* 还回page_lend()借出的帧F，已经没有页映射它了就释放 */
+void page_unlend(struct frame* f) {
+  lock_acquire(&vm_lock);
+  ASSERT(f->lent > 0);
+  if (--f->lent == 0 && list_empty(&f->pages))
+    frame_free(f);
+  lock_release(&vm_lock);
+}
+
+/* 取消页P的映射，需要的话把内容写到交换区。同一帧的其他
+   页已经写过交换区时*SLOT是那个槽，直接共用，否则写完把
+   槽号存到*SLOT。交换区满了返回false，P保持原样。只由帧表
+   在持有vm_lock时调用，帧表负责把P从帧上摘下来 */
+bool page_evict(struct page* p, size_t* slot) {
+  ASSERT(lock_held_by_current_thread(&vm_lock));
+  ASSERT(p->frame != NULL);
+
+  /* 先取消映射，这之后P的所有者不会再改这一页，脏位才是准的 */
+  pagedir_clear_page(p->pagedir, p->upage);
+  if (p->mapped) {
+    write_back(p);
+    return true;
+  }
+  if (pagedir_is_dirty(p->pagedir, p->upage))
+    p->dirty = true;
+
+  if (p->dirty) {
+    if (*slot == SWAP_ERROR) {
+      *slot = swap_out(p->frame->kpage);
+      if (*slot == SWAP_ERROR) {
+        pagedir_set_page(p->pagedir, p->upage, p->frame->kpage,
+                         p->writable && list_size(&p->frame->pages) == 1);
+        pagedir_set_dirty(p->pagedir, p->upage, true);
+        return false;
+      }
+    } else
+      swap_dup(*slot);
+    p->swap_slot = *slot;
+  }
+  return true;
+}
+
+/* 打印统计信息 */
+void page_print_stats(void) {
+  printf("Paging: %lld pages mapped, %lld loaded (%lld from files, %lld from swap), "
+         "%lld shared, %lld stack pages grown\n",
+         added_cnt, loaded_cnt, read_cnt, swapin_cnt, shared_cnt, stack_cnt);
+  if (ra_fault_cnt > 0)
+    printf("Read-ahead: %lld file faults read %lld pages (%lld faults/MB), "
+           "window grew %lld times, shrank %lld times\n",
+           ra_fault_cnt, ra_page_cnt, ra_fault_cnt * (1024 * 1024 / PGSIZE) / ra_page_cnt,
+           ra_grow_cnt, ra_shrink_cnt);
+  if (mapped_cnt > 0)
+    printf("Mmap: %lld pages mapped, %lld written back\n", mapped_cnt, wb_cnt);
+  if (fork_cnt > 0)
+    printf("Copy-on-write: %lld page tables copied, %lld pages copied, "
+           "%lld made writable in place\n",
+           fork_cnt, cow_cnt, reuse_cnt);
+  if (lent_cnt > 0)
+    printf("Page lending: %lld pages lent to pipes, %lld mapped into readers\n", lent_cnt,
+           taken_cnt);
+}
+
+/* 登记一页，返回登记的页。UPAGE已登记过或者内存不够时
+   返回空指针 */
+static struct page* page_add(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                             bool writable, struct readahead* ra) {
+  struct process* pcb = thread_current()->pcb;
+  struct page* p;
+
+  ASSERT(pg_ofs(upage) == 0);
+  ASSERT(is_user_vaddr(upage));
+
+  p = kmem_cache_alloc(page_cache);
+  if (p == NULL)
+    return NULL;
+
+  p->upage = upage;
+  p->pagedir = pcb->pagedir;
+  p->writable = writable;
+  p->file = file;
+  p->file_ofs = ofs;
+  p->read_bytes = read_bytes;
+  p->ra = ra;
+  p->frame = NULL;
+  p->swap_slot = SWAP_ERROR;
+  p->dirty = false;
+  p->mapped = false;
+  p->pinned = 0;
+  lock_acquire(&vm_lock);
+  if (hash_insert(&pcb->pages, &p->elem) != NULL) {
+    lock_release(&vm_lock);
+    kmem_cache_free(page_cache, p);
+    return NULL;
+  }
+  added_cnt++;
+  lock_release(&vm_lock);
+  return p;
+}
+
+/* 返回当前进程中包含UADDR的页，没有登记过则返回空指针。
+   主线程的PCB没有页目录，也就没有补充页表。调用者持有
+   vm_lock：借用进程地址空间的异步I/O工作线程（见ring.c）
+   缺页时也查这张表，和进程自己的插入、删除同时进行 */
+static struct page* lookup(const void* uaddr) {
+  struct process* pcb = thread_current()->pcb;
+  struct page p;
+  struct hash_elem* e;
+
+  ASSERT(lock_held_by_current_thread(&vm_lock));
+  if (pcb == NULL || pcb->pagedir == NULL || !is_user_vaddr(uaddr))
+    return NULL;
+
+  p.upage = pg_round_down(uaddr);
+  e = hash_find(&pcb->pages, &p.elem);
+  return e != NULL ? hash_entry(e, struct page, elem) : NULL;
+}
+
+/* 释放补充页表中的一页 */
+static void page_destroy(struct hash_elem* e, void* aux UNUSED) {
+  free_page(hash_entry(e, struct page, elem));
+}
+
+/* 释放页P：取消映射，释放它占用的帧和交换槽，文件映射的页
+   写过的话先写回文件。调用者持有vm_lock，并且已经把P从
+   补充页表里拿掉了 */
+static void free_page(struct page* p) {
+  ASSERT(p->pinned == 0);
+  if (p->frame != NULL) {
+    pagedir_clear_page(p->pagedir, p->upage);
+    if (p->mapped)
+      write_back(p);
+    frame_remove_page(p->frame, p);
+  }
+  if (p->swap_slot != SWAP_ERROR)
+    swap_free(p->swap_slot);
+  kmem_cache_free(page_cache, p);
+}
+
+/* 文件映射的页P写过的话写回文件。P已经取消映射 */
+static void write_back(struct page* p) {
+  if (pagedir_is_dirty(p->pagedir, p->upage)) {
+    file_write_at(p->file, p->frame->kpage, p->read_bytes, p->file_ofs);
+    wb_cnt++;
+  }
+}
+
+/* 以用户虚拟地址为键 */
+static unsigned page_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct page* p = hash_entry(e, struct page, elem);
+  return hash_bytes(&p->upage, sizeof p->upage);
+}
+
+static bool page_less(const struct hash_elem* a, const struct hash_elem* b, void* aux UNUSED) {
+  return hash_entry(a, struct page, elem)->upage < hash_entry(b, struct page, elem)->upage;
+}
@@ -0,0 +1,74 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct frame;
+struct process;
+
+/* 预读窗口的范围（页数） */
+#define RA_MIN_PAGES 4
+#define RA_MAX_PAGES 16
+
+/* 一段文件映射（可执行文件或者一个mmap）的预读状态 */
+struct readahead {
+  void* next;      /* 顺序访问时下一次缺页的地址 */
+  size_t window;   /* 下一次缺页时读入的页数 */
+};
+
+/* 补充页表项。进程的每个用户虚拟页一项，记录这一页的内容
+   从哪里来、现在在哪里。 */
+struct page {
+  void* upage;           /* 用户虚拟地址，页对齐 */
+  uint32_t* pagedir;     /* 所属进程的页目录 */
+  bool writable;         /* 用户能否写 */
+  struct hash_elem elem; /* 补充页表中的元素 */
+
+  /* 初始内容：从FILE的FILE_OFS处读READ_BYTES字节，其余清零。
+     FILE为空时是全零页 */
+  struct file* file;
+  off_t file_ofs;
+  uint32_t read_bytes;
+  struct readahead* ra; /* 所属映射的预读状态，全零页为空 */
+
+  struct frame* frame;        /* 在内存中时映射的帧，否则为空 */
+  struct list_elem frame_elem; /* 帧的映射者链表中的元素 */
+  size_t swap_slot;    /* 换出到交换区时的槽号，否则为SWAP_ERROR */
+  bool dirty;          /* 内容和初始内容不同，换出时要写交换区 */
+  bool mapped;         /* 文件映射的页，写过的写回FILE而不是交换区 */
+  int pinned;          /* page_pin()的次数，不为零时一直映射着FRAME */
+};
+
+void page_init(void);
+bool page_table_init(struct hash*);
+void page_table_destroy(struct hash*);
+bool page_table_copy(struct process* child, struct process* parent);
+
+void page_readahead_init(struct readahead*);
+bool page_add_file(void* upage, struct file*, off_t ofs, uint32_t read_bytes, bool writable,
+                   struct readahead*);
+bool page_add_zero(void* upage, bool writable);
+bool page_add_mmap(void* upage, struct file*, off_t ofs, uint32_t read_bytes,
+                   struct readahead*);
+void page_remove(void* upage);
+bool page_registered(const void* uaddr);
+bool page_load(const void* uaddr);
+bool page_in_stack(const void* uaddr, const void* esp);
+bool page_grow_stack(const void* uaddr);
+bool page_copy_on_write(const void* uaddr);
+bool page_pin(const void* uaddr, bool write);
+void page_unpin(const void* uaddr);
+bool page_pinned(const void* uaddr);
+struct frame* page_lend(const void* upage);
+bool page_take(void* upage, struct frame*);
+void page_unlend(struct frame*);
+bool page_evict(struct page*, size_t* slot);
+
+void page_print_stats(void);
+
+#endif /* vm/page.h */
@@ -0,0 +1,106 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* 交换区。
+
+   交换设备按页切成槽，每槽SECTORS_PER_SLOT个扇区，用位图
+   记录哪些槽在用。没有交换设备时槽数为0，swap_out()总是
+   失败，被换出的页只能是干净的。
+
+   fork()之后父子进程的页可能共用一个槽，所以每个槽有引用
+   计数，减到0才真正释放。 */
+
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block* swap_device; /* 交换设备，可能为空 */
+static struct bitmap* used_slots; /* 在用的槽 */
+static uint16_t* ref_cnts;        /* 每个槽的引用计数 */
+static struct lock swap_lock;     /* 保护USED_SLOTS和REF_CNTS */
+
+/* 统计 */
+static long long out_cnt; /* 写出的页数 */
+static long long in_cnt;  /* 读入的页数 */
+static size_t slot_cnt;   /* 在用的槽数 */
+static size_t slot_peak;  /* 在用槽数的峰值 */
+
+/* 初始化交换区 */
+void swap_init(void) {
+  size_t slots = 0;
+
+  swap_device = block_get_role(BLOCK_SWAP);
+  if (swap_device != NULL)
+    slots = block_size(swap_device) / SECTORS_PER_SLOT;
+  used_slots = bitmap_create(slots);
+  ref_cnts = calloc(slots + 1, sizeof *ref_cnts); /* malloc(0)返回空指针 */
+  if (used_slots == NULL || ref_cnts == NULL)
+    PANIC("swap bitmap creation failed--swap device is too large");
+  lock_init(&swap_lock);
+}
+
+/* 把KPAGE处的一页写到一个空闲槽里，返回槽号。交换区满了
+   返回SWAP_ERROR */
+size_t swap_out(const void* kpage) {
+  size_t slot, i;
+
+  lock_acquire(&swap_lock);
+  slot = bitmap_scan_and_flip(used_slots, 0, 1, false);
+  if (slot != BITMAP_ERROR) {
+    ref_cnts[slot] = 1;
+    if (++slot_cnt > slot_peak)
+      slot_peak = slot_cnt;
+  }
+  lock_release(&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_ERROR;
+
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_write(swap_device, slot * SECTORS_PER_SLOT + i,
+                (const uint8_t*)kpage + i * BLOCK_SECTOR_SIZE);
+  out_cnt++;
+  return slot;
+}
+
+/* 把槽SLOT读到KPAGE处。槽不释放，用完要调用swap_free() */
+void swap_in(size_t slot, void* kpage) {
+  size_t i;
+
+  ASSERT(bitmap_test(used_slots, slot));
+
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_read(swap_device, slot * SECTORS_PER_SLOT + i, (uint8_t*)kpage + i * BLOCK_SECTOR_SIZE);
+  in_cnt++;
+}
+
+/* 槽SLOT多了一个引用者 */
+void swap_dup(size_t slot) {
+  lock_acquire(&swap_lock);
+  ASSERT(bitmap_test(used_slots, slot));
+  ASSERT(ref_cnts[slot] < UINT16_MAX);
+  ref_cnts[slot]++;
+  lock_release(&swap_lock);
+}
+
+/* 去掉槽SLOT的一个引用者，没有引用者了就释放 */
+void swap_free(size_t slot) {
+  lock_acquire(&swap_lock);
+  ASSERT(bitmap_test(used_slots, slot));
+  if (--ref_cnts[slot] == 0) {
+    bitmap_reset(used_slots, slot);
+    slot_cnt--;
+  }
+  lock_release(&swap_lock);
+}
+
+/* 打印统计信息 */
+void swap_print_stats(void) {
+  if (swap_device == NULL)
+    return;
+  printf("Swap: %zu slots, %zu in use, peak %zu, %lld pages out, %lld pages in\n",
+         bitmap_size(used_slots), slot_cnt, slot_peak, out_cnt, in_cnt);
+}
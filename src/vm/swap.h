@@ -0,0 +1,17 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 分配交换槽失败 */
+#define SWAP_ERROR SIZE_MAX
+
+void swap_init(void);
+size_t swap_out(const void* kpage);
+void swap_in(size_t slot, void* kpage);
+void swap_dup(size_t slot);
+void swap_free(size_t slot);
+void swap_print_stats(void);
+
+#endif /* vm/swap.h */